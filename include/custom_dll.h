@@ -0,0 +1,165 @@
+#ifndef CUSTOM_DLL_H
+#define CUSTOM_DLL_H
+
+// Public types exported by CustomDLL alongside CustomFunctionExample.
+// Callers load the DLL dynamically, so this header only describes the data
+// structures that cross the DLL boundary; fields are only ever appended.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Delivery counters for asynchronous (fire-and-forget) requests
+typedef struct AsyncStats {
+    unsigned long long queued;    // Requests accepted into the async queue
+    unsigned long long delivered; // Completed with an HTTP 2xx status
+    unsigned long long failed;    // Curl error, non-2xx status or abandoned at shutdown
+    unsigned long long dropped;   // Discarded because the queue was full (drop policy)
+    unsigned long long rejected;  // Returned FAIL because the queue was full (block/fail policy)
+} AsyncStats;
+
+// Counters for the response cache
+typedef struct CacheStats {
+    unsigned long long hits;      // Calls answered from the cache
+    unsigned long long misses;    // Cacheable calls that went to the backend
+    unsigned long long evictions; // Entries removed to stay under max_memory_kb
+    unsigned long long entries;   // Entries currently held
+    unsigned long long bytes;     // Approximate memory currently held
+} CacheStats;
+
+// Counters for the circuit breaker and the adaptive timeout
+typedef struct BreakerStats {
+    unsigned long long rejected;  // Calls failed fast while the circuit was open
+    unsigned long long opened;    // Times the circuit opened
+    unsigned long long probes;    // Half-open probe calls let through
+    unsigned long long open;      // 1 while the circuit is open or half-open
+    unsigned long long timeoutMs; // Current adaptive timeout (0 = not in use)
+} BreakerStats;
+
+// Number of CURLcode values counted individually; larger codes share the last slot
+#define DLL_STATS_CURL_CODES 100
+
+// Log-linear latency buckets (HDR-style, 8 sub-buckets per power of two).
+// Bucket i < 8 holds exactly i microseconds. For i >= 8, with k = i / 8 and s = i % 8,
+// bucket i holds values from (8 + s) << (k - 1) up to the next bucket's lower bound.
+// The last bucket also collects everything above its lower bound (about 126 s).
+#define DLL_STATS_LATENCY_BUCKETS 200
+
+// Latency distribution in microseconds
+typedef struct LatencyHistogram {
+    unsigned long long count;
+    unsigned long long sumMicros;
+    unsigned long long maxMicros;
+    unsigned long long buckets[DLL_STATS_LATENCY_BUCKETS];
+} LatencyHistogram;
+
+// Counters for request capture ([capture] section)
+typedef struct CaptureStats {
+    unsigned long long records;  // Request buffers captured
+    unsigned long long dropped;  // Not captured because the capture buffer was full
+    unsigned long long bytes;    // Bytes appended to the capture file
+} CaptureStats;
+
+#define DLL_STATS_VERSION 3
+
+// Snapshot returned by GetDllStats. Counters are cumulative since the DLL was loaded.
+typedef struct DllStats {
+    unsigned long long version;             // DLL_STATS_VERSION of the DLL that filled it
+    unsigned long long calls;               // CustomFunctionExample calls and CustomFunctionBatch requests
+    unsigned long long successes;           // Calls that returned 0
+    unsigned long long failures;            // Calls that returned non-zero
+    unsigned long long transfers;           // Requests actually sent to the backend by callers
+    unsigned long long curlErrors[DLL_STATS_CURL_CODES]; // Failed transfers, indexed by CURLcode
+    unsigned long long timeouts;            // Transfers that hit a connect or total timeout
+    unsigned long long http1xx;             // Non-2xx responses by status class
+    unsigned long long http3xx;
+    unsigned long long http4xx;
+    unsigned long long http5xx;
+    unsigned long long httpOther;           // Status codes outside 100-599 (including none)
+    unsigned long long truncatedResponses;  // CFResp responses longer than the 127-byte output value
+    unsigned long long coalesced;           // Calls that shared another call's in-flight request
+    AsyncStats async;
+    CacheStats cache;
+    LatencyHistogram dns;                   // Name lookup, on new connections
+    LatencyHistogram connect;               // TCP connect after lookup, on new connections
+    LatencyHistogram tls;                   // TLS handshake after connect, on new HTTPS connections
+    LatencyHistogram total;                 // Whole transfer as measured by curl
+    BreakerStats breaker;                   // Since version 2
+    CaptureStats capture;                   // Since version 3
+} DllStats;
+
+// Trace spans written by CustomDLL to its ring file ([trace] output=file).
+//
+// The file is a TraceFileHeader followed by capacity TraceSpan slots. Span n goes to
+// slot n % capacity, so the file always holds the latest capacity spans. A writer first
+// sets the slot's sequence to 2n + 1, then fills the slot and sets sequence to 2n + 2.
+// A reader takes slot n when sequence is 2n + 2 both before and after copying it.
+#define TRACE_FILE_MAGIC 0x5254534FUL // "OSTR"
+#define TRACE_FILE_VERSION 1
+
+// TraceSpan flags
+#define TRACE_SPAN_SENT 0x1           // This call sent a request (not a cache hit, async or coalesced call)
+#define TRACE_SPAN_NEW_CONNECTION 0x2 // The request opened a new connection
+#define TRACE_SPAN_POST 0x4           // The request was a POST
+
+// One CustomFunctionExample call. Durations are in microseconds; the transfer phases
+// come from curl (CURLINFO_*_TIME_T), each measured from the end of the previous one.
+typedef struct TraceSpan {
+    unsigned long long sequence;     // See above
+    unsigned long long startMicros;  // Wall clock at the start of the call, since 1970-01-01 UTC
+    unsigned char traceId[16];       // Sent in the trace header
+    unsigned long long spanId;       // Parent id in the trace header
+    unsigned long long callMicros;   // Whole call inside the DLL
+    unsigned long long parseMicros;  // Parsing dataIn
+    unsigned long long buildMicros;  // Building the URL or POST body
+    unsigned long long dnsMicros;    // Name lookup
+    unsigned long long connectMicros; // TCP connect
+    unsigned long long tlsMicros;    // TLS handshake
+    unsigned long long waitMicros;   // Request sent and server processing, up to the first byte
+    unsigned long long downloadMicros; // First byte to the end of the response
+    unsigned long long totalMicros;  // Whole transfer as measured by curl
+    unsigned long long result;       // Return code of the call (0 = success)
+    unsigned long long curlCode;     // CURLcode of the transfer
+    unsigned long long httpCode;     // HTTP status (0 = none)
+    unsigned long long flags;        // TRACE_SPAN_*
+} TraceSpan;
+
+typedef struct TraceFileHeader {
+    unsigned long long magic;    // TRACE_FILE_MAGIC
+    unsigned long long version;  // TRACE_FILE_VERSION
+    unsigned long long spanSize; // sizeof(TraceSpan)
+    unsigned long long capacity; // Span slots after the header
+    unsigned long long next;     // Number of spans written so far (the next span's n)
+} TraceFileHeader;
+
+// Request buffers captured by CustomDLL ([capture] section).
+//
+// The file is a CaptureFileHeader followed by the records in the order they were
+// captured. Each record is a CaptureRecord followed by size bytes of the call's dataIn,
+// exactly as the caller passed it (the 2-digit count and count 160-byte pairs). Records
+// are not padded, so a reader copies each CaptureRecord out before using it. A DLL that
+// finds a capture file already there appends to it.
+#define CAPTURE_FILE_MAGIC 0x5043534FUL // "OSCP"
+#define CAPTURE_FILE_VERSION 1
+
+// CaptureRecord flags
+#define CAPTURE_RECORD_BATCH 0x1 // The buffer was one request of a CustomFunctionBatch call
+
+typedef struct CaptureRecord {
+    unsigned long long timestampMicros; // Wall clock at the start of the call, since 1970-01-01 UTC
+    unsigned int size;                  // Bytes of dataIn that follow
+    unsigned int flags;                 // CAPTURE_RECORD_*
+} CaptureRecord;
+
+typedef struct CaptureFileHeader {
+    unsigned long long magic;      // CAPTURE_FILE_MAGIC
+    unsigned long long version;    // CAPTURE_FILE_VERSION
+    unsigned long long recordSize; // sizeof(CaptureRecord)
+    unsigned long long reserved;
+} CaptureFileHeader;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CUSTOM_DLL_H
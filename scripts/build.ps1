@@ -8,13 +8,19 @@ param(
     [int]$ServerPort = 8080,
     [bool]$VerifySSL = $true,
     [string]$SSLCertFile = "",
+    [string]$StaticApiUrl = "https://192.168.102.55/testoscc.php",
+    [bool]$StaticVerifySSL = $false,
     [string]$BuildType = "Release",
     [ValidateSet("Runtime", "Static", "Both")]
     [string]$ConfigType = "Both",
     [switch]$BuildTools = $true,
     [switch]$BuildGoServer = $false,
     [switch]$BuildContactCenterSimulator = $false,
-    [switch]$GenerateTestCertificate = $false
+    [switch]$GenerateTestCertificate = $false,
+    [switch]$Lto = $false,
+    [switch]$Pgo = $false,
+    [string]$PgoReplay = "",
+    [int]$PgoDuration = 20
 )
 
 # Change to the root directory (script is in scripts/ folder)
@@ -38,12 +44,32 @@ Write-Host "Connect Timeout: $ConnectTimeout seconds"
 Write-Host "Server Port: $ServerPort"
 Write-Host "Verify SSL: $VerifySSL"
 Write-Host "SSL Certificate File: $SSLCertFile"
+Write-Host "Static DLL API URL: $StaticApiUrl"
+Write-Host "Static DLL Verify SSL: $StaticVerifySSL"
 Write-Host "Build Type: $BuildType"
 Write-Host "Configuration Type: $ConfigType (Runtime = config.ini support, Static = compile-time only)"
 Write-Host "Build Tools: $BuildTools"
 Write-Host "Build Go Server: $BuildGoServer"
 Write-Host "Build Contact Center Simulator: $BuildContactCenterSimulator"
 Write-Host "Generate Test Certificate: $GenerateTestCertificate"
+Write-Host "Link-Time Optimization: $Lto"
+Write-Host "Profile-Guided Optimization: $Pgo"
+
+# Optimization settings (PGO implies LTO). A PGO build is first configured for the
+# instrumented DLLs; the static DLL's URL is compiled in, so it points at the training server.
+$pgoDir = Join-Path $rootDir "build\pgo"
+$trainingUrl = "http://127.0.0.1:$ServerPort/api/index.php"
+$staticVerifyArg = "-DSTATIC_VERIFY_SSL=$(if ($StaticVerifySSL) { 'ON' } else { 'OFF' })"
+if ($Pgo) {
+    $configureApiUrl = $trainingUrl
+    $staticArgs = @("-DSTATIC_API_URL=$trainingUrl", $staticVerifyArg)
+    $optimizeArgs = @("-DPGO_MODE=generate", "-DPGO_PROFILE_DIR=$pgoDir")
+    Remove-Item $pgoDir -Recurse -Force -ErrorAction SilentlyContinue
+} else {
+    $configureApiUrl = $ApiUrl
+    $staticArgs = @("-DSTATIC_API_URL=$StaticApiUrl", $staticVerifyArg)
+    $optimizeArgs = @("-DENABLE_LTO=$(if ($Lto) { 'ON' } else { 'OFF' })", "-DPGO_MODE=off")
+}
 
 # Check if CMake is installed
 $cmakeInstalled = Get-Command "cmake" -ErrorAction SilentlyContinue
@@ -706,7 +732,7 @@ if ($needsCleanBuild) {
 if ($vsGenerator) {
     Write-Host "Using generator: $vsGenerator" -ForegroundColor Green
     # Use quoted variables to avoid issues with Ninja generator
-    cmake -G $vsGenerator -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$ApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort"
+    cmake -G $vsGenerator -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$configureApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort" @staticArgs @optimizeArgs
 } else {
     Write-Host "No specific generator detected. Using CMake default." -ForegroundColor Yellow
     Write-Host "Note: Visual Studio is NOT required to run the DLL, only for building it." -ForegroundColor Cyan
@@ -746,7 +772,7 @@ if ($vsGenerator) {
             if ($testProcess.ExitCode -eq 0) {
                 Write-Host "Using '$generator' generator for the build." -ForegroundColor Green
                 # Use quoted variables to avoid issues with Ninja generator
-                cmake -G $generator -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$ApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort"
+                cmake -G $generator -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$configureApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort" @staticArgs @optimizeArgs
                 $fallbackSuccess = $true
                 break
             }
@@ -917,7 +943,7 @@ if ($vsGenerator) {
 
         try {
             # Use quoted variables to avoid issues with Ninja generator
-            cmake -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$ApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort"
+            cmake -S . -B build -DCMAKE_BUILD_TYPE="$BuildType" -DDEFAULT_API_URL="$configureApiUrl" -DDEFAULT_TIMEOUT="$Timeout" -DDEFAULT_CONNECT_TIMEOUT="$ConnectTimeout" -DDEFAULT_SERVER_PORT="$ServerPort" @staticArgs @optimizeArgs
         } catch {
             Write-Host "Error: CMake configuration failed with default generator." -ForegroundColor Red
             Write-Host "Error details: $_" -ForegroundColor Red
@@ -933,6 +959,54 @@ if ($vsGenerator) {
     }
 }
 
+# Profile-guided optimization: build the instrumented DLLs, train them, then reconfigure for the optimized build
+if ($Pgo) {
+    Write-Host "Building instrumented DLLs for profile-guided optimization..." -ForegroundColor Yellow
+    foreach ($target in @("CustomDLL", "CustomDLLStatic", "TestServer", "TestClient")) {
+        cmake --build build --config "$BuildType" --target $target
+        if ($LASTEXITCODE -ne 0) {
+            Write-Host "Error: Instrumented build of $target failed." -ForegroundColor Red
+            exit 1
+        }
+    }
+
+    # Multi-config generators put the binaries in a per-configuration folder
+    $binDir = "build\bin"
+    if (Test-Path "build\bin\$BuildType\CustomDLL.dll") {
+        $binDir = "build\bin\$BuildType"
+    }
+
+    # Point CustomDLL at the training server for the runs
+    $configPath = Join-Path $binDir "config.ini"
+    $configBackup = "$configPath.pgo-backup"
+    if (Test-Path $configPath) {
+        Copy-Item $configPath -Destination $configBackup -Force
+    }
+    Set-Content -Path $configPath -Value "[api]`nbase_url=$trainingUrl`nverify_ssl=0`nreload_interval=0"
+
+    # MSVC-instrumented DLLs write their counts (.pgc files) next to the .pgd files
+    $env:VCPROFILE_PATH = $pgoDir
+
+    Write-Host "Training on the benchmark workload..." -ForegroundColor Yellow
+    $serverProcess = Start-Process -FilePath (Join-Path $binDir "TestServer.exe") -ArgumentList "--port", "$ServerPort", "--event-loop", "--threads", "4", "--quiet" -NoNewWindow -PassThru
+    Start-Sleep -Seconds 1
+    $testClient = Join-Path $binDir "TestClient.exe"
+    foreach ($dll in @("CustomDLL.dll", "CustomDLLStatic.dll")) {
+        $dllPath = Join-Path $binDir $dll
+        & $testClient --bench --dll $dllPath --threads 8 --duration $PgoDuration
+        if ($PgoReplay) {
+            & $testClient --replay $PgoReplay --dll $dllPath --speed 0 --threads 16
+        }
+    }
+    $serverProcess | Stop-Process -Force
+
+    if (Test-Path $configBackup) {
+        Move-Item $configBackup -Destination $configPath -Force
+    }
+    Write-Host "Training finished. Building the optimized DLLs..." -ForegroundColor Green
+    cmake -S . -B build -DDEFAULT_API_URL="$ApiUrl" -DSTATIC_API_URL="$StaticApiUrl" -DPGO_MODE=use -DPGO_PROFILE_DIR="$pgoDir"
+}
+
 # Build the project based on ConfigType
 if ($ConfigType -eq "Runtime" -or $ConfigType -eq "Both") {
     Write-Host "Building runtime-configurable version (CustomDLL)..."
@@ -15,11 +15,17 @@ API_URL="https://localhost/api/index.php"
 TIMEOUT=4
 CONNECT_TIMEOUT=2
 SERVER_PORT=8080
+STATIC_API_URL="https://192.168.102.55/testoscc.php"
+STATIC_VERIFY_SSL=OFF
 BUILD_TYPE="Release"
 CONFIG_TYPE="both"  # Options: runtime, static, both
 BUILD_TOOLS=true
 BUILD_GO_SERVER=false
 BUILD_CONTACT_CENTER_SIMULATOR=false
+LTO=false
+PGO=false
+PGO_REPLAY=""
+PGO_DURATION=20
 
 # Parse command line arguments
 while [[ $# -gt 0 ]]; do
@@ -40,6 +46,14 @@ while [[ $# -gt 0 ]]; do
       SERVER_PORT="$2"
       shift 2
       ;;
+    --static-api-url)
+      STATIC_API_URL="$2"
+      shift 2
+      ;;
+    --static-verify-ssl)
+      STATIC_VERIFY_SSL=ON
+      shift
+      ;;
     --build-type)
       BUILD_TYPE="$2"
       shift 2
@@ -64,6 +78,22 @@ while [[ $# -gt 0 ]]; do
       BUILD_CONTACT_CENTER_SIMULATOR=true
       shift
       ;;
+    --lto)
+      LTO=true
+      shift
+      ;;
+    --pgo)
+      PGO=true
+      shift
+      ;;
+    --pgo-replay)
+      PGO_REPLAY="$2"
+      shift 2
+      ;;
+    --pgo-duration)
+      PGO_DURATION="$2"
+      shift 2
+      ;;
     *)
       echo "Unknown option: $1"
       exit 1
@@ -76,14 +106,71 @@ echo "API URL: $API_URL"
 echo "Timeout: $TIMEOUT seconds"
 echo "Connect Timeout: $CONNECT_TIMEOUT seconds"
 echo "Server Port: $SERVER_PORT"
+echo "Static DLL API URL: $STATIC_API_URL"
+echo "Static DLL Verify SSL: $STATIC_VERIFY_SSL"
 echo "Build Type: $BUILD_TYPE"
 echo "Configuration Type: $CONFIG_TYPE (runtime = config.ini support, static = compile-time only)"
 echo "Build Tools: $BUILD_TOOLS"
 echo "Build Go Server: $BUILD_GO_SERVER"
 echo "Build Contact Center Simulator: $BUILD_CONTACT_CENTER_SIMULATOR"
+echo "Link-Time Optimization: $LTO"
+echo "Profile-Guided Optimization: $PGO"
+
+# Optimization settings (PGO implies LTO)
+OPTIMIZE_ARGS=(-DENABLE_LTO=$([[ "$LTO" == true ]] && echo ON || echo OFF) -DPGO_MODE=off)
+
+# Profile-guided optimization: build instrumented DLLs, train them, then build the optimized ones
+if [[ "$PGO" == true ]]; then
+  PGO_DIR="$ROOT_DIR/build/pgo"
+  TRAINING_URL="http://127.0.0.1:$SERVER_PORT/api/index.php"
+  echo "Building instrumented DLLs for profile-guided optimization..."
+  rm -rf "$PGO_DIR"
+
+  # The static DLL's URL is compiled in, so the instrumented build points it at the training server
+  cmake -S . -B build -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DDEFAULT_API_URL="$TRAINING_URL" -DSTATIC_API_URL="$TRAINING_URL" -DSTATIC_VERIFY_SSL=$STATIC_VERIFY_SSL -DDEFAULT_TIMEOUT=$TIMEOUT -DDEFAULT_CONNECT_TIMEOUT=$CONNECT_TIMEOUT -DDEFAULT_SERVER_PORT=$SERVER_PORT -DPGO_MODE=generate -DPGO_PROFILE_DIR="$PGO_DIR"
+  for target in CustomDLL CustomDLLStatic TestServer TestClient; do
+    cmake --build build --config $BUILD_TYPE --target $target || exit 1
+  done
+
+  # Pick the DLL file names used on this platform
+  DLL_FILES=()
+  for name in CustomDLL CustomDLLStatic; do
+    for file in "build/bin/$name.dll" "build/bin/lib$name.dll" "build/bin/lib$name.so" "build/bin/$name.so"; do
+      if [[ -f "$file" ]]; then
+        DLL_FILES+=("$file")
+        break
+      fi
+    done
+  done
+  TEST_SERVER=build/bin/TestServer
+  TEST_CLIENT=build/bin/TestClient
+  [[ -f "$TEST_SERVER.exe" ]] && TEST_SERVER="$TEST_SERVER.exe"
+  [[ -f "$TEST_CLIENT.exe" ]] && TEST_CLIENT="$TEST_CLIENT.exe"
+
+  # Point CustomDLL at the training server for the runs
+  cp build/bin/config.ini build/bin/config.ini.pgo-backup 2>/dev/null
+  printf '[api]\nbase_url=%s\nverify_ssl=0\nreload_interval=0\n' "$TRAINING_URL" > build/bin/config.ini
+
+  echo "Training on the benchmark workload..."
+  "$TEST_SERVER" --port $SERVER_PORT --event-loop --threads 4 --quiet &
+  SERVER_PID=$!
+  sleep 1
+  for dll in "${DLL_FILES[@]}"; do
+    "$TEST_CLIENT" --bench --dll "$dll" --threads 8 --duration $PGO_DURATION
+    if [[ -n "$PGO_REPLAY" ]]; then
+      "$TEST_CLIENT" --replay "$PGO_REPLAY" --dll "$dll" --speed 0 --threads 16
+    fi
+  done
+  kill $SERVER_PID 2>/dev/null
+  wait $SERVER_PID 2>/dev/null
+
+  mv -f build/bin/config.ini.pgo-backup build/bin/config.ini 2>/dev/null
+  echo "Training finished. Building the optimized DLLs..."
+  OPTIMIZE_ARGS=(-DPGO_MODE=use -DPGO_PROFILE_DIR="$PGO_DIR")
+fi
 
 # Configure CMake
-cmake -S . -B build -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DDEFAULT_API_URL="$API_URL" -DDEFAULT_TIMEOUT=$TIMEOUT -DDEFAULT_CONNECT_TIMEOUT=$CONNECT_TIMEOUT -DDEFAULT_SERVER_PORT=$SERVER_PORT
+cmake -S . -B build -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DDEFAULT_API_URL="$API_URL" -DSTATIC_API_URL="$STATIC_API_URL" -DSTATIC_VERIFY_SSL=$STATIC_VERIFY_SSL -DDEFAULT_TIMEOUT=$TIMEOUT -DDEFAULT_CONNECT_TIMEOUT=$CONNECT_TIMEOUT -DDEFAULT_SERVER_PORT=$SERVER_PORT "${OPTIMIZE_ARGS[@]}"
 
 # Build the project based on CONFIG_TYPE
 if [[ "$CONFIG_TYPE" == "runtime" || "$CONFIG_TYPE" == "both" ]]; then
@@ -0,0 +1,175 @@
+#ifndef BACKEND_POOL_H
+#define BACKEND_POOL_H
+
+#include <curl/curl.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "circuit_breaker.h"
+#include "dll_stats.h"
+#include "io_engine.h"
+
+// One backend node from base_urls.
+// Nodes are kept by BackendPool for the life of the process and looked up by base URL, so
+// their load and health carry over when config.ini is reloaded.
+struct BackendNode {
+    std::string baseUrl;
+    std::atomic<long> outstanding{0};        // Requests in flight to this node
+    std::atomic<long long> latencyMicros{0}; // Moving average of successful transfer times (0 = none yet)
+    std::atomic<long> consecutiveFailures{0};
+    std::atomic<long long> downUntilMs{0};   // Marked bad until then (0 = healthy)
+
+    explicit BackendNode(std::string url) : baseUrl(std::move(url)) {}
+};
+
+// How requests are spread over the nodes
+enum class BalancePolicy {
+    LeastOutstanding, // The node with the fewest requests in flight
+    LatencyWeighted   // The node with the lowest (requests in flight + 1) x average latency
+};
+
+// Client-side load balancing over several backend nodes.
+//
+// Each request goes to the best healthy node under the policy; ties rotate, so light
+// traffic still reaches every node and keeps its pooled connections warm. A node that
+// fails failureThreshold times in a row (as defined by CircuitBreaker::IsFailure) is
+// marked bad for retryMs. After that a single request is let through as a probe: a
+// success brings the node back, a failure marks it bad again. When every node is bad
+// the one that comes back soonest is used rather than failing the call.
+//
+// The pool also tracks the p95 of successful transfer times, the default delay before
+// a slow request is hedged to a second node.
+class BackendPool {
+public:
+    struct Settings {
+        BalancePolicy policy;
+        long failureThreshold; // Consecutive failures that mark a node bad
+        long retryMs;          // How long a bad node is skipped before it is probed
+    };
+
+    // The node for a base URL, created on first use (called while reading config.ini)
+    BackendNode* Node(const std::string& baseUrl) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (BackendNode& node : nodes) {
+            if (node.baseUrl == baseUrl) {
+                return &node;
+            }
+        }
+        return &nodes.emplace_back(baseUrl);
+    }
+
+    // The node for the next request
+    BackendNode* Pick(const std::vector<BackendNode*>& candidates, long long nowMs, const Settings& settings) {
+        return Choose(candidates, nowMs, settings, nullptr);
+    }
+
+    // A healthy node other than primary for a hedged copy, or nullptr if there is none
+    BackendNode* PickHedge(const std::vector<BackendNode*>& candidates, long long nowMs, const Settings& settings,
+                           const BackendNode* primary) {
+        return Choose(candidates, nowMs, settings, primary);
+    }
+
+    // A request is being sent to node
+    static void Begin(BackendNode* node) {
+        node->outstanding.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A request sent to node finished with this outcome
+    void Finish(BackendNode* node, CURLcode result, long httpCode, const TransferTimings& timings, long long nowMs,
+                const Settings& settings) {
+        node->outstanding.fetch_sub(1, std::memory_order_relaxed);
+
+        if (CircuitBreaker::IsFailure(result, httpCode)) {
+            const long failures = node->consecutiveFailures.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (failures >= settings.failureThreshold) {
+                node->downUntilMs.store(nowMs + settings.retryMs, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        if (node->consecutiveFailures.load(std::memory_order_relaxed) != 0) {
+            node->consecutiveFailures.store(0, std::memory_order_relaxed);
+        }
+        if (node->downUntilMs.load(std::memory_order_relaxed) != 0) {
+            node->downUntilMs.store(0, std::memory_order_relaxed);
+        }
+
+        if (result == CURLE_OK && timings.valid) {
+            // Exponential moving average with a weight of 1/8 for the new sample
+            const long long previous = node->latencyMicros.load(std::memory_order_relaxed);
+            node->latencyMicros.store(previous == 0 ? timings.total : previous + (timings.total - previous) / 8,
+                                      std::memory_order_relaxed);
+            latency.Record(timings.total);
+        }
+    }
+
+    // A request sent to node was withdrawn before it finished (the losing copy of a hedge)
+    static void Cancel(BackendNode* node) {
+        node->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // The p95 of recent successful transfers in milliseconds (0 until there are enough samples)
+    long P95Ms(long long nowMs) {
+        return static_cast<long>((latency.Current(nowMs) + 999) / 1000);
+    }
+
+private:
+    // Best node under the policy, skipping exclude. With no exclude a bad node is used as a
+    // last resort; a hedge only goes to a healthy node.
+    BackendNode* Choose(const std::vector<BackendNode*>& candidates, long long nowMs, const Settings& settings,
+                        const BackendNode* exclude) {
+        const size_t count = candidates.size();
+        const size_t start = rotation.fetch_add(1, std::memory_order_relaxed) % count;
+        BackendNode* best = nullptr;
+        long long bestScore = 0;
+        BackendNode* soonest = nullptr;
+        long long soonestMs = 0;
+
+        for (size_t k = 0; k < count; k++) {
+            BackendNode* node = candidates[(start + k) % count];
+            if (node == exclude) {
+                continue;
+            }
+
+            long long downUntil = node->downUntilMs.load(std::memory_order_relaxed);
+            if (downUntil != 0) {
+                // A bad node whose retry time has come gets one probe; claiming it pushes the
+                // retry time back so concurrent callers keep skipping the node
+                if (nowMs >= downUntil && !exclude &&
+                    node->downUntilMs.compare_exchange_strong(downUntil, nowMs + settings.retryMs,
+                                                              std::memory_order_relaxed)) {
+                    return node;
+                }
+                if (!soonest || downUntil < soonestMs) {
+                    soonest = node;
+                    soonestMs = downUntil;
+                }
+                continue;
+            }
+
+            const long long outstanding = node->outstanding.load(std::memory_order_relaxed);
+            const long long score = settings.policy == BalancePolicy::LatencyWeighted
+                ? (outstanding + 1) * node->latencyMicros.load(std::memory_order_relaxed)
+                : outstanding;
+            if (!best || score < bestScore) {
+                best = node;
+                bestScore = score;
+            }
+        }
+
+        if (!best && !exclude) {
+            return soonest;
+        }
+        return best;
+    }
+
+    std::mutex mutex;
+    std::deque<BackendNode> nodes; // Stable addresses; never shrinks
+    std::atomic<size_t> rotation{0};
+    RecentPercentile latency{95};
+};
+
+#endif // BACKEND_POOL_H
@@ -0,0 +1,306 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "custom_dll.h"
+#include "module_pin.h"
+#include "request_buffer.h"
+
+// Bytes of dataIn a call reads: the count header and the pairs it announces. A count the
+// request path rejects without reading the pairs is captured as the header alone.
+inline size_t CapturedSize(const char* dataIn, unsigned int maxParameters) {
+    const char count[3] = {dataIn[0], dataIn[1], '\0'};
+    const unsigned int pairs = static_cast<unsigned int>(atoi(count));
+    return pairs > maxParameters ? HEADER_SIZE : HEADER_SIZE + pairs * PAIR_SIZE;
+}
+
+// Fixed-size ring of variable-length records, written by any number of calling threads
+// and read by one flush thread.
+//
+// A writer reserves its bytes with a compare-and-swap on the reserve position, copies
+// its record in and then publishes the record's length in the word in front of it. The
+// reader copies out published records in order, zeroes their bytes and releases them
+// back to the writers. Writers never wait: when the reader is too far behind for the
+// record to fit, Push fails and the caller counts the record as dropped.
+class CaptureRing {
+public:
+    // capacity is rounded down to whole 8-byte words
+    explicit CaptureRing(size_t capacity)
+        : words(capacity / WORD), storage(new unsigned long long[words]()) {}
+
+    bool Push(const CaptureRecord& record, const char* data) {
+        const unsigned long long entry = EntrySize(record.size);
+        if (entry > words * WORD) {
+            return false;
+        }
+        unsigned long long head = reserved.load(std::memory_order_relaxed);
+        do {
+            if (head + entry - released.load(std::memory_order_acquire) > words * WORD) {
+                return false;
+            }
+        } while (!reserved.compare_exchange_weak(head, head + entry, std::memory_order_relaxed));
+
+        CopyIn(head + WORD, &record, sizeof(record));
+        CopyIn(head + WORD + sizeof(record), data, record.size);
+        Atomic(head).store(entry, std::memory_order_release);
+        return true;
+    }
+
+    // Append the published records to out (each a CaptureRecord and its data, unpadded)
+    // and release their space. Only the flush thread calls this.
+    void Drain(std::string& out) {
+        unsigned long long tail = released.load(std::memory_order_relaxed);
+        for (;;) {
+            const unsigned long long entry = Atomic(tail).load(std::memory_order_acquire);
+            if (entry == 0) {
+                return; // Not published yet (or nothing left)
+            }
+            CaptureRecord record;
+            CopyOut(tail + WORD, &record, sizeof(record));
+            const size_t offset = out.size();
+            out.resize(offset + sizeof(record) + record.size);
+            memcpy(&out[offset], &record, sizeof(record));
+            CopyOut(tail + WORD + sizeof(record), &out[offset + sizeof(record)], record.size);
+
+            // Publication checks for a non-zero length, so the space goes back zeroed
+            Zero(tail, entry);
+            tail += entry;
+            released.store(tail, std::memory_order_release);
+        }
+    }
+
+private:
+    static constexpr size_t WORD = sizeof(unsigned long long);
+
+    // Length word, record and data, rounded up so the next length word is aligned
+    static unsigned long long EntrySize(unsigned int size) {
+        return (WORD + sizeof(CaptureRecord) + size + WORD - 1) / WORD * WORD;
+    }
+
+    // The length word at ring position (always word-aligned, so never split by the wrap)
+    std::atomic<unsigned long long>& Atomic(unsigned long long position) {
+        static_assert(sizeof(std::atomic<unsigned long long>) == sizeof(unsigned long long) &&
+                      std::atomic<unsigned long long>::is_always_lock_free,
+                      "Length words are published as lock-free atomics");
+        return *reinterpret_cast<std::atomic<unsigned long long>*>(&storage[position / WORD % words]);
+    }
+
+    char* Bytes() { return reinterpret_cast<char*>(storage.get()); }
+
+    // Copy to, copy from and clear length bytes at ring position, wrapping at the end
+    template <typename Operation>
+    void Split(unsigned long long position, size_t length, Operation operation) {
+        const size_t capacity = words * WORD;
+        const size_t offset = static_cast<size_t>(position % capacity);
+        const size_t first = length < capacity - offset ? length : capacity - offset;
+        operation(Bytes() + offset, 0, first);
+        if (first < length) {
+            operation(Bytes(), first, length - first);
+        }
+    }
+
+    void CopyIn(unsigned long long position, const void* data, size_t length) {
+        Split(position, length, [data](char* ring, size_t from, size_t count) {
+            memcpy(ring, static_cast<const char*>(data) + from, count);
+        });
+    }
+
+    void CopyOut(unsigned long long position, void* data, size_t length) {
+        Split(position, length, [data](char* ring, size_t from, size_t count) {
+            memcpy(static_cast<char*>(data) + from, ring, count);
+        });
+    }
+
+    void Zero(unsigned long long position, size_t length) {
+        Split(position, length, [](char* ring, size_t, size_t count) { memset(ring, 0, count); });
+    }
+
+    const size_t words;
+    const std::unique_ptr<unsigned long long[]> storage;
+    std::atomic<unsigned long long> reserved{0}; // Bytes reserved by writers so far
+    std::atomic<unsigned long long> released{0}; // Bytes the reader has finished with
+};
+
+// Capture of the request buffers of every call ([capture] section).
+//
+// The first captured call opens the file, allocates the ring and starts the flush
+// thread, which appends the ring's contents to the file every flush_interval_ms. The
+// file and buffer size are taken from the settings of that first call; enabled can be
+// switched with a config reload, the other settings need the DLL to be reloaded.
+class Capturer {
+public:
+    struct Settings {
+        const std::string* file; // Capture file path
+        long bufferKb;           // In-memory ring between the calls and the flush thread
+        long flushIntervalMs;
+    };
+
+    struct Counters {
+        std::atomic<unsigned long long> records{0};
+        std::atomic<unsigned long long> dropped{0};
+        std::atomic<unsigned long long> bytes{0};
+    };
+
+    // Smallest ring, so the widest request (99 pairs) always fits
+    static constexpr long MIN_BUFFER_KB = 64;
+
+    // Process-wide capture (intentionally never destroyed, like IoEngine: the flush
+    // thread may outlive a shutdown that timed out)
+    static Capturer& Instance() {
+        static Capturer* capturer = new Capturer();
+        return *capturer;
+    }
+
+    void Record(const char* dataIn, size_t size, unsigned int flags, const Settings& settings) {
+        CaptureRing* ring = Ring(settings);
+        if (!ring) {
+            return;
+        }
+        CaptureRecord record;
+        record.timestampMicros = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        record.size = static_cast<unsigned int>(size);
+        record.flags = flags;
+        (ring->Push(record, dataIn) ? counters.records : counters.dropped).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const Counters& GetCounters() const { return counters; }
+
+    // Stop capturing, let the flush thread write out what is still buffered and join it.
+    // Returns false if it is still writing after timeout; calling it again waits again.
+    bool Shutdown(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        if (!worker.joinable()) {
+            return true;
+        }
+        wakeUp.notify_all();
+        if (!workerStopped.wait_for(lock, timeout, [&] { return finished; })) {
+            return false;
+        }
+        lock.unlock();
+        worker.join();
+        return true;
+    }
+
+private:
+    Capturer() = default;
+
+    // The ring, set up by the first call. A file that cannot be opened is not retried.
+    CaptureRing* Ring(const Settings& settings) {
+        if (CaptureRing* ring = current.load(std::memory_order_acquire)) {
+            return ring;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (CaptureRing* ring = current.load(std::memory_order_acquire)) {
+            return ring;
+        }
+        if (stopping || failed) {
+            return nullptr;
+        }
+        file = OpenFile(*settings.file);
+        if (!file) {
+            failed = true;
+            return nullptr;
+        }
+        const long bufferKb = settings.bufferKb > MIN_BUFFER_KB ? settings.bufferKb : MIN_BUFFER_KB;
+        buffer.reset(new CaptureRing(static_cast<size_t>(bufferKb) * 1024));
+        ModulePin::Acquire();
+        worker = std::thread(&Capturer::Run, this, settings.flushIntervalMs > 0 ? settings.flushIntervalMs : 1);
+        current.store(buffer.get(), std::memory_order_release);
+        return buffer.get();
+    }
+
+    // Open the file for appending, starting it over when it is not a capture file of
+    // this version
+    static FILE* OpenFile(const std::string& path) {
+        CaptureFileHeader existing = {};
+        if (FILE* in = fopen(path.c_str(), "rb")) {
+            const size_t read = fread(&existing, 1, sizeof(existing), in);
+            fclose(in);
+            if (read != sizeof(existing)) {
+                existing.magic = 0;
+            }
+        }
+        if (existing.magic == CAPTURE_FILE_MAGIC && existing.version == CAPTURE_FILE_VERSION &&
+            existing.recordSize == sizeof(CaptureRecord)) {
+            return fopen(path.c_str(), "ab");
+        }
+
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) {
+            return nullptr;
+        }
+        CaptureFileHeader header = {};
+        header.magic = CAPTURE_FILE_MAGIC;
+        header.version = CAPTURE_FILE_VERSION;
+        header.recordSize = sizeof(CaptureRecord);
+        if (fwrite(&header, sizeof(header), 1, out) != 1 || fflush(out) != 0) {
+            fclose(out);
+            return nullptr;
+        }
+        return out;
+    }
+
+    void Run(long flushIntervalMs) {
+        for (;;) {
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait_for(lock, std::chrono::milliseconds(flushIntervalMs), [&] { return stopping; });
+                stop = stopping;
+            }
+            if (stop) {
+                break;
+            }
+            Flush();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        FlushAndClose();
+        finished = true;
+        workerStopped.notify_all();
+    }
+
+    // Append the published records to the file (flush thread)
+    void Flush() {
+        pending.clear();
+        buffer->Drain(pending);
+        if (!pending.empty() && fwrite(pending.data(), 1, pending.size(), file) == pending.size()) {
+            counters.bytes.fetch_add(pending.size(), std::memory_order_relaxed);
+        }
+        fflush(file);
+    }
+
+    void FlushAndClose() {
+        Flush();
+        fclose(file);
+        file = nullptr;
+    }
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable workerStopped;
+    std::thread worker;
+    std::atomic<CaptureRing*> current{nullptr};
+    std::unique_ptr<CaptureRing> buffer;
+    FILE* file = nullptr; // Used by the flush thread only
+    std::string pending;  // Records on their way to the file
+    bool stopping = false;
+    bool finished = false;
+    bool failed = false;
+    Counters counters;
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,174 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <curl/curl.h>
+#include <atomic>
+
+#include "custom_dll.h"
+#include "dll_stats.h"
+
+// Circuit breaker in front of the backend.
+//
+// Consecutive transfers that time out, fail to connect or get a 5xx response count as
+// failures; any other outcome resets the count. Once failureThreshold is reached the
+// circuit opens and calls fail straight away instead of each waiting out its timeout.
+// After openMs the circuit is half-open: up to maxProbes calls go through as probes. A
+// probe that succeeds closes the circuit; one that fails opens it for another openMs.
+//
+// The state is a few atomics, so a closed circuit costs one relaxed load per call.
+class CircuitBreaker {
+public:
+    struct Settings {
+        long failureThreshold; // Consecutive failures that open the circuit
+        long openMs;           // How long the circuit stays open before probing
+        long maxProbes;        // Probes in flight at once while half-open
+    };
+
+    // Whether a call may go to the backend
+    enum class Permit {
+        Allowed, // Circuit closed
+        Probe,   // Circuit half-open; the call's outcome decides the state
+        Rejected // Circuit open; fail without sending
+    };
+
+    struct Counters {
+        std::atomic<unsigned long long> rejected{0}; // Calls failed fast while open
+        std::atomic<unsigned long long> opened{0};   // Times the circuit opened
+        std::atomic<unsigned long long> probes{0};   // Half-open probes sent
+    };
+
+    Permit Acquire(long long nowMs, const Settings& settings) {
+        const long long openUntil = openUntilMs.load(std::memory_order_acquire);
+        if (openUntil == 0) {
+            return Permit::Allowed;
+        }
+        if (nowMs >= openUntil) {
+            // Half-open: take a probe slot if one is free
+            long inFlight = probesInFlight.load(std::memory_order_relaxed);
+            while (inFlight < settings.maxProbes) {
+                if (probesInFlight.compare_exchange_weak(inFlight, inFlight + 1, std::memory_order_acq_rel)) {
+                    counters.probes.fetch_add(1, std::memory_order_relaxed);
+                    return Permit::Probe;
+                }
+            }
+        }
+        counters.rejected.fetch_add(1, std::memory_order_relaxed);
+        return Permit::Rejected;
+    }
+
+    // Record the outcome of a call that was let through
+    void Record(Permit permit, CURLcode result, long httpCode, long long nowMs, const Settings& settings) {
+        if (permit == Permit::Probe) {
+            probesInFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        if (!IsFailure(result, httpCode)) {
+            if (consecutiveFailures.load(std::memory_order_relaxed) != 0) {
+                consecutiveFailures.store(0, std::memory_order_relaxed);
+            }
+            if (openUntilMs.load(std::memory_order_relaxed) != 0) {
+                openUntilMs.store(0, std::memory_order_release);
+            }
+            return;
+        }
+
+        const long failures = consecutiveFailures.fetch_add(1, std::memory_order_relaxed) + 1;
+        long long openUntil = openUntilMs.load(std::memory_order_relaxed);
+        if (permit == Permit::Probe) {
+            // The backend is still failing: stay open for another interval
+            openUntilMs.store(nowMs + settings.openMs, std::memory_order_release);
+        } else if (openUntil == 0 && failures >= settings.failureThreshold &&
+                   openUntilMs.compare_exchange_strong(openUntil, nowMs + settings.openMs,
+                                                       std::memory_order_acq_rel)) {
+            counters.opened.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Give back a permit whose call did not send anything (it joined another call)
+    void Release(Permit permit) {
+        if (permit == Permit::Probe) {
+            probesInFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    // Milliseconds until the next probe may go out (0 when closed or half-open)
+    long long RetryInMs(long long nowMs) const {
+        const long long openUntil = openUntilMs.load(std::memory_order_relaxed);
+        return openUntil > nowMs ? openUntil - nowMs : 0;
+    }
+
+    // Whether the circuit is open or half-open
+    bool IsOpen() const {
+        return openUntilMs.load(std::memory_order_relaxed) != 0;
+    }
+
+    long ConsecutiveFailures() const {
+        return consecutiveFailures.load(std::memory_order_relaxed);
+    }
+
+    const Counters& GetCounters() const {
+        return counters;
+    }
+
+    // Timeouts, failed connects and 5xx responses mean the backend is unhealthy
+    static bool IsFailure(CURLcode result, long httpCode) {
+        if (result != CURLE_OK) {
+            return result == CURLE_OPERATION_TIMEDOUT || result == CURLE_COULDNT_CONNECT ||
+                   result == CURLE_COULDNT_RESOLVE_HOST;
+        }
+        return httpCode >= 500 && httpCode < 600;
+    }
+
+private:
+    std::atomic<long> consecutiveFailures{0};
+    std::atomic<long long> openUntilMs{0}; // 0 while closed
+    std::atomic<long> probesInFlight{0};
+    Counters counters;
+};
+
+// Per-request timeout that follows the backend's recent latency.
+//
+// Successful transfer times feed a RecentPercentile (see dll_stats.h). The timeout is
+// its p99 times a multiplier, kept between a floor and the configured timeout. Until
+// enough samples have been seen the configured timeout is used as it is.
+class AdaptiveTimeout {
+public:
+    struct Settings {
+        long ceilingMs;  // The configured timeout; never exceeded
+        long floorMs;    // Never go below this
+        long multiplier; // Timeout as a multiple of p99
+    };
+
+    // The timeout to use for the next request, in milliseconds
+    long CurrentMs(long long nowMs, const Settings& settings) {
+        const unsigned long long p99Micros = p99.Current(nowMs);
+        if (p99Micros == 0) {
+            return settings.ceilingMs;
+        }
+        long long timeout = static_cast<long long>((p99Micros + 999) / 1000) * settings.multiplier;
+        if (timeout < settings.floorMs) {
+            timeout = settings.floorMs;
+        }
+        const long current = timeout < settings.ceilingMs ? static_cast<long>(timeout) : settings.ceilingMs;
+        if (lastMs.load(std::memory_order_relaxed) != current) {
+            lastMs.store(current, std::memory_order_relaxed);
+        }
+        return current;
+    }
+
+    // The last computed timeout in milliseconds (0 until there are enough samples)
+    long LastMs() const {
+        return lastMs.load(std::memory_order_relaxed);
+    }
+
+    // Add the total time of a finished transfer
+    void Record(long long micros) {
+        p99.Record(micros);
+    }
+
+private:
+    RecentPercentile p99{99};
+    std::atomic<long> lastMs{0};
+};
+
+#endif // CIRCUIT_BREAKER_H
@@ -0,0 +1,94 @@
+#ifndef CURL_HANDLE_POOL_H
+#define CURL_HANDLE_POOL_H
+
+#include <curl/curl.h>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+// Per-thread pool of reusable curl easy handles.
+//
+// Every calling thread owns exactly one easy handle for its lifetime. The handle is
+// reset between calls with curl_easy_reset(), which clears the options but keeps the
+// handle's connection cache, DNS cache and TLS session cache, so consecutive requests
+// to the same base URL reuse a warm keep-alive connection instead of paying a new
+// TCP connect and TLS handshake. The fast path touches only thread-local state; the
+// registry mutex is taken once per thread (creation) and at teardown.
+class CurlHandlePool {
+public:
+    // Connection reuse limits applied to every acquired handle
+    struct Limits {
+        long maxIdleConnections; // CURLOPT_MAXCONNECTS: idle connections kept per handle
+        long idleTimeout;        // CURLOPT_MAXAGE_CONN: seconds before an idle connection is dropped
+    };
+
+    // Return this thread's easy handle, creating it on first use.
+    // The handle is reset to default options with its connections retained.
+    // Returns nullptr if curl_easy_init() fails or the pool has been shut down.
+    static CURL* Acquire(const Limits& limits) {
+        ThreadSlot& slot = LocalSlot();
+
+        if (!slot.handle) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (shutDown) {
+                return nullptr;
+            }
+            slot.handle = curl_easy_init();
+            if (!slot.handle) {
+                return nullptr;
+            }
+            registry.push_back(&slot);
+        } else {
+            curl_easy_reset(slot.handle);
+        }
+
+        curl_easy_setopt(slot.handle, CURLOPT_MAXCONNECTS, limits.maxIdleConnections);
+        curl_easy_setopt(slot.handle, CURLOPT_MAXAGE_CONN, limits.idleTimeout);
+
+        // Keep TLS session tickets so a reconnect can resume instead of full handshake
+        curl_easy_setopt(slot.handle, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+
+        return slot.handle;
+    }
+
+    // Clean up all handles still owned by live threads and refuse new ones.
+    // Called on DLL shutdown (CustomDllShutdown, or DllMain in CustomDLLStatic) before
+    // curl_global_cleanup().
+    static void Shutdown() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        shutDown = true;
+        for (ThreadSlot* slot : registry) {
+            if (slot->handle) {
+                curl_easy_cleanup(slot->handle);
+                slot->handle = nullptr;
+            }
+        }
+        registry.clear();
+    }
+
+private:
+    // Thread-local owner of one easy handle; released when the thread exits
+    struct ThreadSlot {
+        CURL* handle = nullptr;
+
+        ~ThreadSlot() {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (handle) {
+                curl_easy_cleanup(handle);
+                handle = nullptr;
+            }
+            registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+        }
+    };
+
+    static ThreadSlot& LocalSlot() {
+        thread_local ThreadSlot slot;
+        return slot;
+    }
+
+    static inline std::mutex registryMutex;
+    static inline std::vector<ThreadSlot*> registry;
+    static inline bool shutDown = false;
+};
+
+#endif // CURL_HANDLE_POOL_H
@@ -0,0 +1,74 @@
+#ifndef CURL_SHARE_H
+#define CURL_SHARE_H
+
+#include <curl/curl.h>
+#include <mutex>
+
+// Process-wide curl share handles.
+//
+// Every easy handle in the DLL (the per-thread pool and the shared engine's handles)
+// attaches to a share, so a name resolved or a TLS session negotiated by one routing
+// thread is reused by all of them instead of being lost with the handle that created
+// it. A handle can attach to only one share, so there is one share per combination of
+// shared data, created on first use. libcurl serializes access through the lock
+// callbacks below, one mutex per kind of shared data.
+class CurlShare {
+public:
+    static CurlShare& Instance() {
+        static CurlShare* share = new CurlShare();
+        return *share;
+    }
+
+    // The share for the requested data, or nullptr if nothing is shared or it could not be created
+    CURLSH* Get(bool dns, bool sslSessions) {
+        const size_t kind = (dns ? 1 : 0) | (sslSessions ? 2 : 0);
+        if (kind == 0) {
+            return nullptr;
+        }
+
+        std::call_once(created[kind], [this, kind] {
+            CURLSH* share = curl_share_init();
+            if (!share) {
+                return;
+            }
+            curl_share_setopt(share, CURLSHOPT_LOCKFUNC, Lock);
+            curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, Unlock);
+            curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+            if (kind & 1) {
+                curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            }
+            if (kind & 2) {
+                curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            }
+            handles[kind] = share;
+        });
+        return handles[kind];
+    }
+
+    // Release the shares. Called by CustomDllShutdown after every easy handle has been cleaned up;
+    // libcurl refuses (CURLSHE_IN_USE) while a handle still references a share.
+    void Shutdown() {
+        for (CURLSH*& share : handles) {
+            if (share && curl_share_cleanup(share) == CURLSHE_OK) {
+                share = nullptr;
+            }
+        }
+    }
+
+private:
+    CurlShare() = default;
+
+    static void Lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<CurlShare*>(userptr)->locks[data].lock();
+    }
+
+    static void Unlock(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<CurlShare*>(userptr)->locks[data].unlock();
+    }
+
+    std::once_flag created[4];
+    CURLSH* handles[4] = {nullptr, nullptr, nullptr, nullptr};
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+};
+
+#endif // CURL_SHARE_H
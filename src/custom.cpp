@@ -1,38 +1,94 @@
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 #include <string_view>
-#include <map>
 #include <curl/curl.h>
 #include <windows.h>
 #include <mutex>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "custom_dll.h"
+#include "curl_share.h"
+#include "module_pin.h"
+#include "request_engine.h"
+#include "warm_up.h"
+
+// Maximum number of key/value pairs accepted in one request
+constexpr unsigned int MAX_PARAMETERS = 100;
+
+// Maximum number of output pairs (the 2-digit count header)
+constexpr unsigned int MAX_OUTPUT_PAIRS = 99;
+
+// CA certificates loaded from ssl_cert_file, passed to curl as CURLOPT_CAINFO_BLOB
+struct CaBundle {
+    std::string pem;
+    curl_blob blob;
+
+    explicit CaBundle(std::string contents) : pem(std::move(contents)) {
+        blob.data = pem.data();
+        blob.len = pem.size();
+        blob.flags = CURL_BLOB_NOCOPY; // The bundle lives as long as its config snapshot
+    }
 
-// Error codes
-enum ErrorCode {
-    SUCCESS = 0,
-    FAIL = 1
+    CaBundle(const CaBundle&) = delete;
+    CaBundle& operator=(const CaBundle&) = delete;
 };
 
-// Global error message buffer
-thread_local char g_lastErrorMessage[512] = {0};
-
-// Function to set the last error message
-void SetLastErrorMessage(const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    vsnprintf(g_lastErrorMessage, sizeof(g_lastErrorMessage), format, args);
-    va_end(args);
+// Read a certificate file into memory, or return nullptr if it cannot be read
+std::shared_ptr<const CaBundle> LoadCaBundle(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (contents.empty()) {
+        return nullptr;
+    }
+    return std::make_shared<const CaBundle>(std::move(contents));
 }
 
-// Configuration settings
+// Configuration settings, the Config of RequestEngine for CustomDLL
 struct ConfigSettings {
+    static constexpr unsigned int MAX_PARAMETERS = ::MAX_PARAMETERS;
+    static constexpr bool RUNTIME_FEATURES = true;
+    static constexpr bool CFRESP_ACCEPTS_ONE = false;
+    static constexpr bool LOWERCASE_ENDPOINT = false;
+    static constexpr bool FAIL_ONLY_WITH_CFRESP = false;
+
+    // The current snapshot of config.ini
+    static const ConfigSettings& Current();
+
 #ifdef DEFAULT_API_URL
     std::string baseUrl = DEFAULT_API_URL;
 #else
     std::string baseUrl = "https://localhost/api/index.php";
 #endif
 
+    // baseUrl followed by '?', the start of every GET URL
+    std::string urlPrefix = baseUrl + '?';
+
+    // Backend nodes from base_urls, with baseUrl the first of them (empty = baseUrl only)
+    std::vector<BackendNode*> backends;
+    BalancePolicy balancePolicy = BalancePolicy::LeastOutstanding;
+    long nodeFailureThreshold = 3;
+    long nodeRetryMs = 10000;
+
+    // Send a second copy of a slow GET to another node (hedgeDelayMs 0 = the recent p95)
+    bool hedgeRequests = false;
+    long hedgeDelayMs = 0;
+
+    BackendPool::Settings GetBackendSettings() const {
+        return {balancePolicy, nodeFailureThreshold, nodeRetryMs};
+    }
+
 #ifdef DEFAULT_TIMEOUT
     long timeout = DEFAULT_TIMEOUT;
 #else
@@ -52,26 +108,254 @@ struct ConfigSettings {
 #endif
 
     std::string sslCertFile = "";
+
+    // Contents of sslCertFile, read once per snapshot and handed to curl from memory
+    std::shared_ptr<const CaBundle> caBundle;
+
+    // Share TLS sessions between all handles so new connections can resume
+    bool sharedTlsSessions = true;
+
+    // Connection reuse for the pooled per-thread curl handle
+    long maxIdleConnections = 2;
+    long idleTimeout = 60;
+
+    // Seconds between checks of config.ini for changes (0 = load once)
+    long reloadInterval = 5;
+
+    // Fire-and-forget delivery for calls without CFResp=yes
+    bool asyncMode = false;
+    long asyncQueueSize = 1024;
+    long asyncMaxInFlight = 32;
+    OverflowPolicy asyncOverflow = OverflowPolicy::Drop;
+
+    // Route synchronous calls through the shared curl_multi engine instead of per-thread handles
+    bool sharedEngine = false;
+    bool http2 = false;
+    long maxHostConnections = 0;
+
+    // Let concurrent identical requests share one backend call
+    bool coalesceRequests = false;
+
+    // Fail fast while the backend keeps timing out or failing ([circuit_breaker] section)
+    bool circuitBreaker = false;
+    long breakerFailureThreshold = 5;
+    long breakerOpenMs = 5000;
+    long breakerProbes = 1;
+
+    CircuitBreaker::Settings GetBreakerSettings() const {
+        return {breakerFailureThreshold, breakerOpenMs, breakerProbes};
+    }
+
+    // Shorten the timeout to a multiple of the recent p99 latency (never above timeout)
+    bool adaptiveTimeout = false;
+    long adaptiveTimeoutMinMs = 250;
+    long adaptiveTimeoutMultiplier = 3;
+
+    AdaptiveTimeout::Settings GetAdaptiveTimeoutSettings() const {
+        return {timeout * 1000, adaptiveTimeoutMinMs, adaptiveTimeoutMultiplier};
+    }
+
+    // Spans for one call in every traceSampleEvery ([trace] section)
+    bool traceEnabled = false;
+    long traceSampleEvery = 100;
+    TraceOutput traceOutput = TraceOutput::File;
+    std::string traceFile;           // Ring file, next to config.ini by default
+    long traceRingSpans = 16384;
+    std::string traceHeader = "traceparent"; // Header that carries the trace id (empty = none)
+
+    Tracer::Settings GetTraceSettings() const {
+        return {traceOutput, &traceFile, traceRingSpans};
+    }
+
+    // Raw request buffers appended to a capture file for replay ([capture] section)
+    bool captureEnabled = false;
+    std::string captureFile;         // Next to config.ini by default
+    long captureBufferKb = 1024;
+    long captureFlushIntervalMs = 200;
+
+    Capturer::Settings GetCaptureSettings() const {
+        return {&captureFile, captureBufferKb, captureFlushIntervalMs};
+    }
+
+    // Connections opened before the first calls need them ([warmup] section)
+    bool warmupEnabled = false;
+    long warmupConnections = 2;
+
+    // A HEAD request per connection to every backend node (at most max_idle_connections
+    // per node, the most the pools keep)
+    WarmUp::Settings GetWarmUpSettings() const {
+        WarmUp::Settings settings{{}, GetTransferOptions(), std::min(warmupConnections, maxIdleConnections),
+                                  sharedEngine, GetEngineLimits()};
+        if (backends.empty()) {
+            settings.urls.push_back(baseUrl);
+        }
+        for (const BackendNode* node : backends) {
+            settings.urls.push_back(node->baseUrl);
+        }
+        return settings;
+    }
+
+    // Requests of one CustomFunctionBatch call in flight at once
+    long batchMaxConcurrency = 32;
+
+    // Send the parameters as a POST body instead of a GET query string
+    bool postRequests = false;
+    BodyFormat postFormat = BodyFormat::Form;
+    long gzipMinBytes = 0; // Gzip bodies at least this large (0 = never)
+    std::shared_ptr<curl_slist> postHeaders;     // Content-Type of the body
+    std::shared_ptr<curl_slist> gzipPostHeaders; // Content-Type and Content-Encoding: gzip
+
+    // Streaming extraction of the CFResp value ([response] section)
+    ResponseExtract responseExtract = ResponseExtract::Body;
+    std::string responseJsonField;
+    long responseDrainBytes = 16384; // Body read past a complete value before the transfer is aborted
+
+    // Whether responses go through a ResponseExtractor instead of a buffer
+    bool StreamsResponse() const { return responseExtract != ResponseExtract::Body; }
+
+    // Response mapping: output key i is filled from response field i ([response_map] section)
+    ResponseExtractor::Format responseMapFormat = ResponseExtractor::Format::Json;
+    std::vector<std::string> responseMapKeys;
+    std::vector<std::string> responseMapFields;
+
+    // Whether the output is the mapped pairs rather than CFResp
+    bool MapsResponse() const { return responseExtract == ResponseExtract::Map; }
+
+    // Bytes of output written for a mapped response
+    size_t MappedOutputSize() const { return HEADER_SIZE + responseMapKeys.size() * PAIR_SIZE; }
+
+    // Response cache for idempotent endpoints ([cache] and [cache_ttl] sections)
+    bool cacheEnabled = false;
+    long cacheMaxMemoryKb = 1024;
+    long cacheDefaultTtl = 0;
+    std::vector<std::pair<std::string, long>> cacheTtls; // Seconds per endpoint name
+
+    // Cache lifetime for a request's endpoint parameter (0 = do not cache)
+    long CacheTtlFor(const Parameter* endpoint) const {
+        if (endpoint) {
+            for (const auto& [name, ttl] : cacheTtls) {
+                if (EqualsIgnoreCase(name, endpoint->value)) {
+                    return ttl;
+                }
+            }
+        }
+        return cacheDefaultTtl;
+    }
+
+    // DNS caching and connect tuning ([dns] and [dns_resolve] sections)
+    bool sharedDnsCache = true;
+    long dnsCacheTimeout = 60;
+    long happyEyeballsTimeoutMs = 0;
+    long ipResolve = CURL_IPRESOLVE_WHATEVER;
+    std::shared_ptr<curl_slist> resolveList; // Pinned host:port:address entries
+
+    // Options for one transfer with these settings
+    TransferOptions GetTransferOptions() const {
+        TransferOptions options;
+        options.timeout = timeout;
+        options.connectTimeout = connectTimeout;
+        options.idleTimeout = idleTimeout;
+        options.verifySSL = verifySSL;
+        options.sslCertFile = sslCertFile.c_str();
+        options.http2 = http2;
+        options.caBundle = caBundle ? &caBundle->blob : nullptr;
+        options.share = CurlShare::Instance().Get(sharedDnsCache, sharedTlsSessions);
+        options.resolve = resolveList.get();
+        options.dnsCacheTimeout = dnsCacheTimeout;
+        options.happyEyeballsTimeoutMs = happyEyeballsTimeoutMs;
+        options.ipResolve = ipResolve;
+        return options;
+    }
+
+    // Queue and connection limits for the shared engine (idle connections for each node)
+    IoEngine::Limits GetEngineLimits() const {
+        return {
+            static_cast<size_t>(asyncQueueSize),
+            static_cast<size_t>(asyncMaxInFlight),
+            backends.empty() ? maxIdleConnections : maxIdleConnections * static_cast<long>(backends.size()),
+            maxHostConnections
+        };
+    }
 };
 
-// Function to read configuration from INI file
-ConfigSettings ReadConfig() {
-    ConfigSettings config;
+// Parse an address family name from config.ini (any, v4 or v6)
+long ParseIpResolve(const char* name) {
+    if (EqualsIgnoreCase(name, "v4")) return CURL_IPRESOLVE_V4;
+    if (EqualsIgnoreCase(name, "v6")) return CURL_IPRESOLVE_V6;
+    return CURL_IPRESOLVE_WHATEVER;
+}
 
+// Parse a load balancing policy name from config.ini (least_outstanding or latency)
+BalancePolicy ParseBalancePolicy(const char* name) {
+    if (EqualsIgnoreCase(name, "latency")) return BalancePolicy::LatencyWeighted;
+    return BalancePolicy::LeastOutstanding;
+}
+
+// Split a comma-separated list from config.ini, dropping spaces around the entries
+std::vector<std::string> ParseList(std::string_view text) {
+    std::vector<std::string> entries;
+    while (!text.empty()) {
+        const size_t comma = text.find(',');
+        std::string_view entry = text.substr(0, comma);
+        const size_t first = entry.find_first_not_of(" \t");
+        if (first != std::string_view::npos) {
+            entry = entry.substr(first, entry.find_last_not_of(" \t") - first + 1);
+            entries.emplace_back(entry);
+        }
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+    }
+    return entries;
+}
+
+// Parse a request method name from config.ini (get or post); true for POST
+bool ParsePostMethod(const char* name) {
+    return EqualsIgnoreCase(name, "post");
+}
+
+// Parse a POST body format name from config.ini (form or json)
+BodyFormat ParseBodyFormat(const char* name) {
+    if (EqualsIgnoreCase(name, "json")) return BodyFormat::Json;
+    return BodyFormat::Form;
+}
+
+// Parse a response extraction mode from config.ini (body, prefix or json)
+ResponseExtract ParseResponseExtract(const char* name) {
+    if (EqualsIgnoreCase(name, "prefix")) return ResponseExtract::Prefix;
+    if (EqualsIgnoreCase(name, "json")) return ResponseExtract::Json;
+    if (EqualsIgnoreCase(name, "map")) return ResponseExtract::Map;
+    return ResponseExtract::Body;
+}
+
+// Parse an overflow policy name from config.ini (block, drop or fail)
+OverflowPolicy ParseOverflowPolicy(const char* name, OverflowPolicy fallback) {
+    if (EqualsIgnoreCase(name, "block")) return OverflowPolicy::Block;
+    if (EqualsIgnoreCase(name, "drop")) return OverflowPolicy::Drop;
+    if (EqualsIgnoreCase(name, "fail")) return OverflowPolicy::Fail;
+    return fallback;
+}
+
+// Locate config.ini next to the DLL (resolved once, the module path does not change)
+std::string GetConfigPath() {
     // Get the directory where the DLL is located
     char dllPath[MAX_PATH] = {0};
     HMODULE hModule = NULL;
     GetModuleHandleEx(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | 
                       GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                      (LPCSTR)&ReadConfig, &hModule);
+                      (LPCSTR)&GetConfigPath, &hModule);
     GetModuleFileName(hModule, dllPath, sizeof(dllPath));
 
     // Get the directory path
     std::filesystem::path dllDir = std::filesystem::path(dllPath).parent_path();
-    std::string configPath = (dllDir / "config.ini").string();
+    return (dllDir / "config.ini").string();
+}
+
+// Function to read configuration from INI file
+ConfigSettings ReadConfig(const std::string& configPath) {
+    ConfigSettings config;
 
     // Check if config file exists, if not, use default values
-    if (!std::filesystem::exists(configPath)) {
+    std::error_code ec;
+    if (!std::filesystem::exists(configPath, ec)) {
         return config;
     }
 
@@ -81,6 +365,28 @@ ConfigSettings ReadConfig() {
                            baseUrl, sizeof(baseUrl), configPath.c_str());
     config.baseUrl = baseUrl;
 
+    // Read the backend nodes: base_urls lists several base URLs and replaces base_url
+    char baseUrls[2048] = {0};
+    GetPrivateProfileString("api", "base_urls", "", baseUrls, sizeof(baseUrls), configPath.c_str());
+    const std::vector<std::string> nodeUrls = ParseList(baseUrls);
+    if (!nodeUrls.empty()) {
+        config.baseUrl = nodeUrls.front();
+    }
+    if (nodeUrls.size() > 1) {
+        for (const std::string& url : nodeUrls) {
+            config.backends.push_back(g_backendPool.Node(url));
+        }
+    }
+    config.urlPrefix = config.baseUrl + '?';
+
+    char balance[32] = {0};
+    GetPrivateProfileString("api", "balance", "least_outstanding", balance, sizeof(balance), configPath.c_str());
+    config.balancePolicy = ParseBalancePolicy(balance);
+    config.nodeFailureThreshold = GetPrivateProfileInt("api", "node_failure_threshold", config.nodeFailureThreshold, configPath.c_str());
+    config.nodeRetryMs = GetPrivateProfileInt("api", "node_retry_ms", config.nodeRetryMs, configPath.c_str());
+    config.hedgeRequests = GetPrivateProfileInt("api", "hedge", config.hedgeRequests ? 1 : 0, configPath.c_str()) != 0;
+    config.hedgeDelayMs = GetPrivateProfileInt("api", "hedge_delay_ms", config.hedgeDelayMs, configPath.c_str());
+
     // Read timeout
     config.timeout = GetPrivateProfileInt("api", "timeout", config.timeout, configPath.c_str());
 
@@ -97,255 +403,490 @@ ConfigSettings ReadConfig() {
                            sslCertFile, sizeof(sslCertFile), configPath.c_str());
     config.sslCertFile = sslCertFile;
 
-    return config;
-}
+    // Load the certificate file once; curl falls back to reading the path if this fails
+    if (config.verifySSL && !config.sslCertFile.empty()) {
+        config.caBundle = LoadCaBundle(config.sslCertFile);
+    }
 
-// Global curl initialization mutex
-std::mutex curlInitMutex;
-bool curlGlobalInitialized = false;
+    // Read TLS session sharing setting
+    config.sharedTlsSessions = GetPrivateProfileInt("api", "share_ssl_sessions", config.sharedTlsSessions ? 1 : 0, configPath.c_str()) != 0;
+
+    // Read connection reuse limits
+    config.maxIdleConnections = GetPrivateProfileInt("api", "max_idle_connections", config.maxIdleConnections, configPath.c_str());
+    config.idleTimeout = GetPrivateProfileInt("api", "idle_timeout", config.idleTimeout, configPath.c_str());
+
+    // Read how often the file is checked for changes (0 = never reload)
+    config.reloadInterval = GetPrivateProfileInt("api", "reload_interval", config.reloadInterval, configPath.c_str());
+
+    // Read async (fire-and-forget) settings
+    config.asyncMode = GetPrivateProfileInt("api", "async_mode", config.asyncMode ? 1 : 0, configPath.c_str()) != 0;
+    config.asyncQueueSize = GetPrivateProfileInt("api", "async_queue_size", config.asyncQueueSize, configPath.c_str());
+    config.asyncMaxInFlight = GetPrivateProfileInt("api", "async_max_in_flight", config.asyncMaxInFlight, configPath.c_str());
+
+    char asyncOverflow[16] = {0};
+    GetPrivateProfileString("api", "async_overflow", "drop", asyncOverflow, sizeof(asyncOverflow), configPath.c_str());
+    config.asyncOverflow = ParseOverflowPolicy(asyncOverflow, config.asyncOverflow);
+
+    // Read shared engine settings
+    config.sharedEngine = GetPrivateProfileInt("api", "shared_engine", config.sharedEngine ? 1 : 0, configPath.c_str()) != 0;
+    config.http2 = GetPrivateProfileInt("api", "http2", config.http2 ? 1 : 0, configPath.c_str()) != 0;
+    config.maxHostConnections = GetPrivateProfileInt("api", "max_host_connections", config.maxHostConnections, configPath.c_str());
+
+    // Read request coalescing setting
+    config.coalesceRequests = GetPrivateProfileInt("api", "coalesce_requests", config.coalesceRequests ? 1 : 0, configPath.c_str()) != 0;
+
+    // Read adaptive timeout settings
+    config.adaptiveTimeout = GetPrivateProfileInt("api", "adaptive_timeout", config.adaptiveTimeout ? 1 : 0, configPath.c_str()) != 0;
+    config.adaptiveTimeoutMinMs = GetPrivateProfileInt("api", "adaptive_timeout_min_ms", config.adaptiveTimeoutMinMs, configPath.c_str());
+    config.adaptiveTimeoutMultiplier = GetPrivateProfileInt("api", "adaptive_timeout_multiplier", config.adaptiveTimeoutMultiplier, configPath.c_str());
+
+    // Read circuit breaker settings
+    config.circuitBreaker = GetPrivateProfileInt("circuit_breaker", "enabled", config.circuitBreaker ? 1 : 0, configPath.c_str()) != 0;
+    config.breakerFailureThreshold = GetPrivateProfileInt("circuit_breaker", "failure_threshold", config.breakerFailureThreshold, configPath.c_str());
+    config.breakerOpenMs = GetPrivateProfileInt("circuit_breaker", "open_ms", config.breakerOpenMs, configPath.c_str());
+    config.breakerProbes = GetPrivateProfileInt("circuit_breaker", "half_open_probes", config.breakerProbes, configPath.c_str());
+
+    // Read tracing settings
+    config.traceEnabled = GetPrivateProfileInt("trace", "enabled", config.traceEnabled ? 1 : 0, configPath.c_str()) != 0;
+    config.traceSampleEvery = GetPrivateProfileInt("trace", "sample_every", config.traceSampleEvery, configPath.c_str());
+
+    char traceOutput[8] = {0};
+    GetPrivateProfileString("trace", "output", "file", traceOutput, sizeof(traceOutput), configPath.c_str());
+    config.traceOutput = EqualsIgnoreCase(traceOutput, "etw") ? TraceOutput::Etw : TraceOutput::File;
+
+    char traceFile[MAX_PATH] = {0};
+    const std::string defaultTraceFile = std::filesystem::path(configPath).replace_filename("trace.bin").string();
+    GetPrivateProfileString("trace", "file", defaultTraceFile.c_str(), traceFile, sizeof(traceFile), configPath.c_str());
+    config.traceFile = traceFile[0] != '\0' ? traceFile : defaultTraceFile;
+    config.traceRingSpans = GetPrivateProfileInt("trace", "ring_spans", config.traceRingSpans, configPath.c_str());
+
+    char traceHeader[64] = {0};
+    GetPrivateProfileString("trace", "header", config.traceHeader.c_str(), traceHeader, sizeof(traceHeader), configPath.c_str());
+    config.traceHeader = traceHeader;
+
+    // Read capture settings
+    config.captureEnabled = GetPrivateProfileInt("capture", "enabled", config.captureEnabled ? 1 : 0, configPath.c_str()) != 0;
+
+    char captureFile[MAX_PATH] = {0};
+    const std::string defaultCaptureFile = std::filesystem::path(configPath).replace_filename("capture.bin").string();
+    GetPrivateProfileString("capture", "file", defaultCaptureFile.c_str(), captureFile, sizeof(captureFile), configPath.c_str());
+    config.captureFile = captureFile[0] != '\0' ? captureFile : defaultCaptureFile;
+    config.captureBufferKb = GetPrivateProfileInt("capture", "buffer_kb", config.captureBufferKb, configPath.c_str());
+    config.captureFlushIntervalMs = GetPrivateProfileInt("capture", "flush_interval_ms", config.captureFlushIntervalMs, configPath.c_str());
+
+    // Read warm-up settings
+    config.warmupEnabled = GetPrivateProfileInt("warmup", "enabled", config.warmupEnabled ? 1 : 0, configPath.c_str()) != 0;
+    config.warmupConnections = GetPrivateProfileInt("warmup", "connections", config.warmupConnections, configPath.c_str());
+
+    // Read batch concurrency limit
+    config.batchMaxConcurrency = GetPrivateProfileInt("api", "batch_max_concurrency", config.batchMaxConcurrency, configPath.c_str());
+
+    // Read request method and body encoding
+    char method[8] = {0};
+    GetPrivateProfileString("api", "method", "get", method, sizeof(method), configPath.c_str());
+    config.postRequests = ParsePostMethod(method);
+
+    char postFormat[8] = {0};
+    GetPrivateProfileString("api", "post_format", "form", postFormat, sizeof(postFormat), configPath.c_str());
+    config.postFormat = ParseBodyFormat(postFormat);
+    config.gzipMinBytes = GetPrivateProfileInt("api", "gzip_min_bytes", config.gzipMinBytes, configPath.c_str());
+
+    // Build the body headers once per snapshot
+    if (config.postRequests) {
+        const char* contentType = config.postFormat == BodyFormat::Json
+            ? "Content-Type: application/json"
+            : "Content-Type: application/x-www-form-urlencoded";
+        config.postHeaders.reset(curl_slist_append(nullptr, contentType), curl_slist_free_all);
+        curl_slist* gzipHeaders = curl_slist_append(nullptr, contentType);
+        if (gzipHeaders) {
+            gzipHeaders = curl_slist_append(gzipHeaders, "Content-Encoding: gzip");
+        }
+        config.gzipPostHeaders.reset(gzipHeaders, curl_slist_free_all);
+    }
 
-// DllMain function
-BOOL APIENTRY DllMain(HANDLE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
-{
-    // Initialize curl globally when DLL is loaded
-    if (ul_reason_for_call == DLL_PROCESS_ATTACH) {
-        std::lock_guard<std::mutex> lock(curlInitMutex);
-        if (!curlGlobalInitialized) {
-            curl_global_init(CURL_GLOBAL_DEFAULT);
-            curlGlobalInitialized = true;
+    // Read DNS cache and connect settings
+    config.sharedDnsCache = GetPrivateProfileInt("dns", "shared_cache", config.sharedDnsCache ? 1 : 0, configPath.c_str()) != 0;
+    config.dnsCacheTimeout = GetPrivateProfileInt("dns", "cache_timeout", config.dnsCacheTimeout, configPath.c_str());
+    config.happyEyeballsTimeoutMs = GetPrivateProfileInt("dns", "happy_eyeballs_timeout_ms", config.happyEyeballsTimeoutMs, configPath.c_str());
+
+    char ipResolve[8] = {0};
+    GetPrivateProfileString("dns", "ip_resolve", "any", ipResolve, sizeof(ipResolve), configPath.c_str());
+    config.ipResolve = ParseIpResolve(ipResolve);
+
+    // Read pinned addresses: each line of [dns_resolve] is host:port=address[,address...]
+    char resolveEntries[4096] = {0};
+    GetPrivateProfileSection("dns_resolve", resolveEntries, sizeof(resolveEntries), configPath.c_str());
+    curl_slist* resolveList = nullptr;
+    for (const char* line = resolveEntries; *line; line += strlen(line) + 1) {
+        std::string entry = line;
+        const size_t separator = entry.find('=');
+        if (separator != std::string::npos && separator != 0) {
+            entry[separator] = ':';
+            resolveList = curl_slist_append(resolveList, entry.c_str());
         }
-    } else if (ul_reason_for_call == DLL_PROCESS_DETACH) {
-        std::lock_guard<std::mutex> lock(curlInitMutex);
-        if (curlGlobalInitialized) {
-            curl_global_cleanup();
-            curlGlobalInitialized = false;
+    }
+    config.resolveList.reset(resolveList, curl_slist_free_all);
+
+    // Read response extraction settings
+    char responseExtract[8] = {0};
+    GetPrivateProfileString("response", "extract", "body", responseExtract, sizeof(responseExtract), configPath.c_str());
+    config.responseExtract = ParseResponseExtract(responseExtract);
+
+    char jsonField[256] = {0};
+    GetPrivateProfileString("response", "json_field", "", jsonField, sizeof(jsonField), configPath.c_str());
+    config.responseJsonField = jsonField;
+    config.responseDrainBytes = GetPrivateProfileInt("response", "drain_bytes", config.responseDrainBytes, configPath.c_str());
+
+    char mapFormat[8] = {0};
+    GetPrivateProfileString("response", "map_format", "json", mapFormat, sizeof(mapFormat), configPath.c_str());
+    config.responseMapFormat = EqualsIgnoreCase(mapFormat, "kv") ? ResponseExtractor::Format::KeyValue
+                                                                 : ResponseExtractor::Format::Json;
+
+    // Read the response mapping: each line of [response_map] is output_key=response_field
+    char responseMap[4096] = {0};
+    GetPrivateProfileSection("response_map", responseMap, sizeof(responseMap), configPath.c_str());
+    for (const char* line = responseMap; *line; line += strlen(line) + 1) {
+        const char* separator = strchr(line, '=');
+        if (separator && separator != line && separator[1] != '\0' &&
+            config.responseMapKeys.size() < MAX_OUTPUT_PAIRS) {
+            config.responseMapKeys.emplace_back(line, separator - line);
+            config.responseMapFields.emplace_back(separator + 1);
         }
     }
-    return TRUE;
-}
 
-// Callback function for curl to write response data
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp)
-{
-    const size_t totalSize = size * nmemb;
-    userp->append(static_cast<char*>(contents), totalSize);
-    return totalSize;
-}
-
-// URL encode a string
-std::string UrlEncode(const std::string& value, CURL* curl) {
-    char* encoded = curl_easy_escape(curl, value.c_str(), static_cast<int>(value.length()));
-    if (encoded) {
-        std::string result(encoded);
-        curl_free(encoded);
-        return result;
+    // Mapping without entries has nothing to return; fall back to the plain body
+    if (config.MapsResponse() && config.responseMapKeys.empty()) {
+        config.responseExtract = ResponseExtract::Body;
     }
-    return value; // Return original if encoding fails
-}
 
-extern "C"
-{
-    // Function to get the last error message
-    __declspec(dllexport) const char* GetLastErrorMessage() {
-        return g_lastErrorMessage;
+    // Read response cache settings
+    config.cacheEnabled = GetPrivateProfileInt("cache", "enabled", config.cacheEnabled ? 1 : 0, configPath.c_str()) != 0;
+    config.cacheMaxMemoryKb = GetPrivateProfileInt("cache", "max_memory_kb", config.cacheMaxMemoryKb, configPath.c_str());
+    config.cacheDefaultTtl = GetPrivateProfileInt("cache", "default_ttl", config.cacheDefaultTtl, configPath.c_str());
+
+    // Read per-endpoint TTLs: each line of [cache_ttl] is endpoint=seconds
+    char cacheTtls[4096] = {0};
+    GetPrivateProfileSection("cache_ttl", cacheTtls, sizeof(cacheTtls), configPath.c_str());
+    for (const char* line = cacheTtls; *line; line += strlen(line) + 1) {
+        const char* separator = strchr(line, '=');
+        if (separator && separator != line) {
+            config.cacheTtls.emplace_back(std::string(line, separator - line), atol(separator + 1));
+        }
     }
 
-    __declspec(dllexport) long CustomFunctionExample(const char* dataIn, char* dataOut) 
-    {
-        try {
-            // Constants for parsing input/output
-            constexpr unsigned int HEADER_SIZE = 2;
-            constexpr unsigned int KEY_SIZE = 32;
-            constexpr unsigned int VALUE_SIZE = 128;
-            constexpr unsigned int PAIR_SIZE = KEY_SIZE + VALUE_SIZE;
-
-            // Ensure dataIn is not null
-            if (!dataIn) {
-                SetLastErrorMessage("Invalid input: dataIn is null");
-                return FAIL;
-            }
-
-            // Determine number of input parameters
-            char numParametersAsString[3] = {dataIn[0], dataIn[1], '\0'};
-            const unsigned int numParameters = atoi(numParametersAsString);
-
-            // Validate number of parameters
-            if (numParameters > 100) { // Arbitrary limit for safety
-                SetLastErrorMessage("Too many parameters: %d (maximum is 100)", numParameters);
-                return FAIL;
-            }
-
-            // Map to store key/value pairs
-            std::map<std::string, std::string> parameters;
-            bool shouldReturnResponse = false;
-
-            // Read each input parameter
-            for (unsigned int i = 0; i < numParameters; i++)
-            {
-                // Allocate on stack for better performance
-                char key[KEY_SIZE + 1] = {0};
-                char value[VALUE_SIZE + 1] = {0};
-
-                const unsigned int keyIndex = HEADER_SIZE + i * PAIR_SIZE;
-                const unsigned int valueIndex = keyIndex + KEY_SIZE;
-
-                // Copy key and value, ensuring null termination
-                memcpy(key, dataIn + keyIndex, KEY_SIZE);
-                memcpy(value, dataIn + valueIndex, VALUE_SIZE);
-
-                key[KEY_SIZE] = '\0';
-                value[VALUE_SIZE] = '\0';
-
-                // Create string_view first to avoid unnecessary string copies
-                // std::string_view automatically stops at the first null character
-                std::string_view keyView(key);
+    return config;
+}
 
-                // For value, we can use strlen since we trust null-termination
-                size_t valueLength = strlen(value);
-                std::string_view valueView(value, valueLength);
+// Cached configuration
+//
+// The configuration is read once and published as an immutable snapshot through an
+// atomic pointer, so the request path does no file I/O. Every reloadInterval seconds
+// one caller compares the file's modification time and, if it changed, publishes a
+// fresh snapshot. Old snapshots are kept alive until the DLL unloads because other
+// threads may still be using them; a reload only happens when the file is edited.
+std::atomic<const ConfigSettings*> g_config{nullptr};
+std::atomic<long long> g_nextConfigCheck{0};
+std::mutex g_configMutex;
+std::vector<std::unique_ptr<const ConfigSettings>> g_configSnapshots;
+std::string g_configPath;
+std::filesystem::file_time_type g_configWriteTime;
+
+// Read config.ini and publish it as the current snapshot (caller holds g_configMutex)
+const ConfigSettings* PublishConfig() {
+    std::error_code ec;
+    g_configWriteTime = std::filesystem::last_write_time(g_configPath, ec);
+
+    g_configSnapshots.push_back(std::make_unique<const ConfigSettings>(ReadConfig(g_configPath)));
+    const ConfigSettings* snapshot = g_configSnapshots.back().get();
+
+    g_nextConfigCheck.store(SteadyMillis() + snapshot->reloadInterval * 1000, std::memory_order_relaxed);
+    g_config.store(snapshot, std::memory_order_release);
+    return snapshot;
+}
 
-                // Convert to strings only when needed
-                std::string keyStr(keyView);
-                std::string valueStr(valueView);
+// Get the current configuration snapshot, loading or refreshing it when due
+const ConfigSettings& GetConfig() {
+    const ConfigSettings* config = g_config.load(std::memory_order_acquire);
 
-                // Store in map
-                parameters[keyStr] = valueStr;
+    if (!config) {
+        std::lock_guard<std::mutex> lock(g_configMutex);
+        config = g_config.load(std::memory_order_acquire);
+        if (!config) {
+            g_configPath = GetConfigPath();
+            config = PublishConfig();
+        }
+        return *config;
+    }
 
-                // Check if CFResp is set to yes
-                if (keyStr == "CFResp" && valueStr == "yes") {
-                    shouldReturnResponse = true;
-                }
-            }
+    if (config->reloadInterval <= 0) {
+        return *config;
+    }
 
-            // Initialize curl
-            CURL* curl = curl_easy_init();
-            if (!curl) {
-                SetLastErrorMessage("Failed to initialize curl");
-                return FAIL;
-            }
+    // Only one caller per interval wins the check; everyone else keeps the current snapshot
+    long long nextCheck = g_nextConfigCheck.load(std::memory_order_relaxed);
+    const long long now = SteadyMillis();
+    if (now < nextCheck ||
+        !g_nextConfigCheck.compare_exchange_strong(nextCheck, now + config->reloadInterval * 1000,
+                                                   std::memory_order_relaxed)) {
+        return *config;
+    }
 
-            // Use RAII to ensure curl cleanup
-            struct CurlCleanup {
-                CURL* curl;
-                CurlCleanup(CURL* c) : curl(c) {}
-                ~CurlCleanup() { if (curl) curl_easy_cleanup(curl); }
-            } curlGuard(curl);
+    std::lock_guard<std::mutex> lock(g_configMutex);
+    std::error_code ec;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(g_configPath, ec);
+    if (writeTime != g_configWriteTime) {
+        config = PublishConfig();
+    }
+    return *config;
+}
 
-            // Read configuration settings
-            ConfigSettings config = ReadConfig();
+const ConfigSettings& ConfigSettings::Current() {
+    return GetConfig();
+}
 
-            // Construct URL for GET request with proper encoding
-            std::string url = config.baseUrl + "?";
-            bool firstParam = true;
+// How long CustomDllShutdown waits for queued async requests by default
+constexpr long ASYNC_DRAIN_TIMEOUT_MS = 2000;
 
-            // Reserve space for URL to avoid reallocations
-            url.reserve(256);
+// Global curl initialization mutex
+std::mutex curlInitMutex;
+bool curlGlobalInitialized = false;
 
-            for (const auto& [key, value] : parameters) {
-                // Skip CFResp parameter in URL
-                if (key == "CFResp") {
-                    continue;
-                }
+// DLL lifecycle
+//
+// DllMain runs under the loader lock, so it does no curl or network work at load time.
+// The first call, or CustomDllInitialize, initializes curl, loads config.ini and starts
+// the warm-up in the background. CustomDllShutdown turns new calls away, lets the calls
+// in flight, the warm-up and the async queue finish, joins the background threads and
+// then releases curl. After that the DLL stays shut down. A host that never calls it
+// has curl released on DLL_PROCESS_DETACH, as long as no background thread was started.
+std::atomic<bool> g_initialized{false};
+std::atomic<bool> g_shutDown{false};
+std::atomic<long> g_activeCalls{0};
+std::mutex g_lifecycleMutex;
+std::mutex g_shutdownMutex;
+
+// Initialize curl, load the configuration and start the warm-up, once.
+// Returns false if the DLL has been shut down.
+bool InitializeDll() {
+    std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+    if (g_shutDown.load()) {
+        return false;
+    }
+    if (g_initialized.load(std::memory_order_relaxed)) {
+        return true;
+    }
 
-                if (!firstParam) {
-                    url += "&";
-                }
+    {
+        std::lock_guard<std::mutex> curlLock(curlInitMutex);
+        if (!curlGlobalInitialized) {
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+            curlGlobalInitialized = true;
+        }
+    }
 
-                // URL encode both key and value
-                url += key + "=" + UrlEncode(value, curl);
-                firstParam = false;
-            }
+    const ConfigSettings& config = GetConfig();
+    if (config.warmupEnabled && config.warmupConnections > 0) {
+        WarmUp::Instance().Start(config.GetWarmUpSettings());
+    }
+    g_initialized.store(true, std::memory_order_release);
+    return true;
+}
 
-            // Initialize response string with reasonable capacity
-            std::string responseData;
-            responseData.reserve(1024);
+// Release the pooled handles, the share handle, the trace ring and curl itself, once
+// nothing can be using them any more (from ShutdownDll, or DllMain when no background
+// thread was ever started)
+void ReleaseCurl() {
+    std::lock_guard<std::mutex> curlLock(curlInitMutex);
+    if (curlGlobalInitialized) {
+        // Release pooled handles (and their connections) before global cleanup
+        CurlHandlePool::Shutdown();
+        CurlShare::Instance().Shutdown();
+        g_tracer.Shutdown();
+        curl_global_cleanup();
+        curlGlobalInitialized = false;
+    }
+}
 
-            // Set URL
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+// Stop the DLL. Calls in flight, the warm-up and queued async requests get up to
+// drainTimeout to finish. Returns false, leaving curl and the module pin in place,
+// if a call or a background thread is still running after that; calling it again retries.
+bool ShutdownDll(std::chrono::milliseconds drainTimeout) {
+    std::lock_guard<std::mutex> shutdownLock(g_shutdownMutex);
+    g_shutDown.store(true);
+
+    const auto deadline = std::chrono::steady_clock::now() + drainTimeout;
+    auto remaining = [&] {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::max(deadline - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration::zero()));
+    };
+
+    // Calls that got in before the flag was set
+    while (g_activeCalls.load() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 
-            // Set timeout from configuration
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, config.timeout);
+    WarmUp::Instance().Stop();
+    const bool engineStopped = IoEngine::Instance().Shutdown(remaining());
+    const bool warmUpStopped = WarmUp::Instance().Wait(remaining() + std::chrono::seconds(1));
 
-            // Set connection timeout from configuration
-            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, config.connectTimeout);
+    // Write out the captured requests still in the buffer
+    const bool captureStopped = Capturer::Instance().Shutdown(std::chrono::seconds(1));
 
-            // Follow redirects
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
+    if (g_activeCalls.load() > 0 || !engineStopped || !warmUpStopped || !captureStopped) {
+        return false;
+    }
 
-            // Enable TCP keepalive
-            curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    std::lock_guard<std::mutex> lock(g_lifecycleMutex);
+    ReleaseCurl();
+    ModulePin::Release();
+    return true;
+}
 
-            // Use HTTP/1.1
-            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+// Counts an exported call as in flight for the duration of its scope, initializing the
+// DLL on the first call. Entered() is false once the DLL has been shut down.
+class ActiveCall {
+public:
+    ActiveCall() {
+        g_activeCalls.fetch_add(1);
+        entered = !g_shutDown.load() && (g_initialized.load(std::memory_order_acquire) || InitializeDll());
+        if (!entered) {
+            SetLastErrorMessage("CustomDLL has been shut down");
+        }
+    }
 
-            // Set write callback function
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseData);
+    ~ActiveCall() {
+        g_activeCalls.fetch_sub(1, std::memory_order_release);
+    }
 
-            // Configure SSL options
-            if (!config.verifySSL) {
-                // Disable SSL certificate verification
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-            } else if (!config.sslCertFile.empty()) {
-                // Use custom certificate file
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-                curl_easy_setopt(curl, CURLOPT_CAINFO, config.sslCertFile.c_str());
-            }
+    ActiveCall(const ActiveCall&) = delete;
+    ActiveCall& operator=(const ActiveCall&) = delete;
 
-            // Perform the request
-            CURLcode res = curl_easy_perform(curl);
+    bool Entered() const { return entered; }
 
-            // Check for errors
-            if (res != CURLE_OK) {
-                SetLastErrorMessage("Curl request failed: %s", curl_easy_strerror(res));
-                return FAIL;
-            }
+private:
+    bool entered;
+};
 
-            // Get HTTP response code
-            long httpCode = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+// DllMain function
+BOOL APIENTRY DllMain(HANDLE hModule, DWORD ul_reason_for_call, LPVOID lpReserved)
+{
+    // Nothing to do on load; the first call initializes the DLL. DllMain cannot wait for
+    // the background threads, but FreeLibrary only gets here when none can be running:
+    // none was started (once one is, ModulePin keeps the DLL loaded), or CustomDllShutdown
+    // has joined them and released curl already. At process exit they are already gone,
+    // possibly holding curl's or the CRT's locks, so nothing is released.
+    if (ul_reason_for_call == DLL_PROCESS_DETACH && lpReserved == NULL) {
+        g_shutDown.store(true);
+        ReleaseCurl();
+    }
+    return TRUE;
+}
 
-            // Check if HTTP response is successful (200-299)
-            if (httpCode < 200 || httpCode >= 300) {
-                SetLastErrorMessage("HTTP error: received status code %ld", httpCode);
-                return FAIL;
-            }
+// The request path, specialized for the runtime configuration
+using Engine = RequestEngine<ConfigSettings>;
 
-            // If CFResp=yes was in the input, return the response
-            if (shouldReturnResponse && dataOut) {
-                // Set number of output parameters to 1
-                dataOut[0] = '0';
-                dataOut[1] = '1';
+extern "C"
+{
+    // Function to get the last error message
+    __declspec(dllexport) const char* GetLastErrorMessage() {
+        return g_lastErrorMessage;
+    }
 
-                // Prepare output key/value
-                char outputKey[KEY_SIZE] = {0};
-                char outputValue[VALUE_SIZE] = {0};
+    // Function to get the async delivery counters
+    __declspec(dllexport) void GetAsyncStats(AsyncStats* stats) {
+        if (!stats) {
+            return;
+        }
+        const IoEngine::Counters& counters = IoEngine::Instance().GetCounters();
+        stats->queued = counters.queued.load(std::memory_order_relaxed);
+        stats->delivered = counters.delivered.load(std::memory_order_relaxed);
+        stats->failed = counters.failed.load(std::memory_order_relaxed);
+        stats->dropped = counters.dropped.load(std::memory_order_relaxed);
+        stats->rejected = counters.rejected.load(std::memory_order_relaxed);
+    }
 
-                // Set key to "CFResp"
-                strncpy(outputKey, "CFResp", KEY_SIZE - 1);
+    // Function to get the response cache counters
+    __declspec(dllexport) void GetCacheStats(CacheStats* stats) {
+        if (!stats) {
+            return;
+        }
+        const ResponseCache::Counters& counters = g_responseCache.GetCounters();
+        stats->hits = counters.hits.load(std::memory_order_relaxed);
+        stats->misses = counters.misses.load(std::memory_order_relaxed);
+        stats->evictions = counters.evictions.load(std::memory_order_relaxed);
+        g_responseCache.GetUsage(stats->entries, stats->bytes);
+    }
 
-                // Copy response data to output value (truncate if too long)
-                strncpy(outputValue, responseData.c_str(), VALUE_SIZE - 1);
+    // Function to get a snapshot of the call metrics. size is sizeof(DllStats) as the
+    // caller compiled it; only that many bytes are written, so older callers keep working.
+    __declspec(dllexport) void GetDllStats(DllStats* stats, size_t size) {
+        if (!stats || size == 0) {
+            return;
+        }
+        DllStats snapshot = {};
+        g_metrics.CopyTo(snapshot);
+        snapshot.coalesced = g_singleFlight.GetCounters().coalesced.load(std::memory_order_relaxed);
+        GetAsyncStats(&snapshot.async);
+        GetCacheStats(&snapshot.cache);
+        const CircuitBreaker::Counters& breaker = g_circuitBreaker.GetCounters();
+        snapshot.breaker.rejected = breaker.rejected.load(std::memory_order_relaxed);
+        snapshot.breaker.opened = breaker.opened.load(std::memory_order_relaxed);
+        snapshot.breaker.probes = breaker.probes.load(std::memory_order_relaxed);
+        snapshot.breaker.open = g_circuitBreaker.IsOpen() ? 1 : 0;
+        snapshot.breaker.timeoutMs = static_cast<unsigned long long>(g_adaptiveTimeout.LastMs());
+        const Capturer::Counters& capture = Capturer::Instance().GetCounters();
+        snapshot.capture.records = capture.records.load(std::memory_order_relaxed);
+        snapshot.capture.dropped = capture.dropped.load(std::memory_order_relaxed);
+        snapshot.capture.bytes = capture.bytes.load(std::memory_order_relaxed);
+        memcpy(stats, &snapshot, size < sizeof(snapshot) ? size : sizeof(snapshot));
+    }
 
-                // Write to output buffer
-                memcpy(dataOut + HEADER_SIZE, outputKey, KEY_SIZE);
-                memcpy(dataOut + HEADER_SIZE + KEY_SIZE, outputValue, VALUE_SIZE);
-            }
+    // Initialize the DLL ahead of the first call: initialize curl, load config.ini and
+    // start the warm-up in the background. Optional, the first call does the same;
+    // returns non-zero after CustomDllShutdown.
+    __declspec(dllexport) long CustomDllInitialize()
+    {
+        if (!InitializeDll()) {
+            SetLastErrorMessage("CustomDLL has been shut down");
+            return FAIL;
+        }
+        return SUCCESS;
+    }
 
-            return SUCCESS; // Success
+    // Shut the DLL down before it is unloaded: later calls fail, while the calls in flight,
+    // the warm-up and queued async requests get up to drainTimeoutMs (negative = the
+    // default) to finish before curl is released. Returns non-zero, with curl
+    // still in place, if some of them were still running; it can then be called again.
+    __declspec(dllexport) long CustomDllShutdown(long drainTimeoutMs)
+    {
+        if (!ShutdownDll(std::chrono::milliseconds(drainTimeoutMs < 0 ? ASYNC_DRAIN_TIMEOUT_MS : drainTimeoutMs))) {
+            SetLastErrorMessage("CustomDllShutdown timed out with calls or background requests still running");
+            return FAIL;
         }
-        catch (const std::exception& e) {
-            // Catch standard exceptions
-            SetLastErrorMessage("Unexpected exception: %s", e.what());
+        return SUCCESS;
+    }
+
+    __declspec(dllexport) long CustomFunctionExample(const char* dataIn, char* dataOut) 
+    {
+        const ActiveCall call;
+        if (!call.Entered()) {
             return FAIL;
         }
-        catch (...) {
-            // Catch any other unexpected exceptions
-            SetLastErrorMessage("Unknown exception occurred");
+        const long result = Engine::Handle(dataIn, dataOut);
+        g_metrics.RecordCall(result == SUCCESS);
+        return result;
+    }
+
+    // Process count request buffers in one call. The requests are sent concurrently
+    // (at most batch_max_concurrency at a time) and each dataOut[i] is filled in the
+    // usual output format; results[i] is that request's return code. Returns 0 only
+    // if every request succeeded.
+    __declspec(dllexport) long CustomFunctionBatch(const char** dataIn, char** dataOut, long* results, size_t count)
+    {
+        const ActiveCall call;
+        if (!call.Entered()) {
             return FAIL;
         }
+        return Engine::HandleBatch(dataIn, dataOut, results, count);
     }
 }
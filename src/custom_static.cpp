@@ -1,42 +1,76 @@
-#include <cstdlib>
-#include <cstring>
 #include <string>
 #include <string_view>
-#include <map>
 #include <curl/curl.h>
 #include <windows.h>
 #include <mutex>
 
-// Error codes
-enum ErrorCode {
-    SUCCESS = 0,
-    FAIL = 1
-};
-
-// Global error message buffer
-thread_local char g_lastErrorMessage[512] = {0};
-
-// Function to set the last error message
-void SetLastErrorMessage(const char* format, ...) {
-    va_list args;
-    va_start(args, format);
-    vsnprintf(g_lastErrorMessage, sizeof(g_lastErrorMessage), format, args);
-    va_end(args);
-}
-
-// Configuration settings - compile-time only, no runtime loading
-struct ConfigSettings {
-    // Use the values from config.ini at build time
-    const char* baseUrl = "https://192.168.102.55/testoscc.php";
-    const long timeout = 4;
-    const long connectTimeout = 2;
-    const bool verifySSL = false; // Set to false to ignore SSL certificate validation
-    const char* sslCertFile = ""; // Path to SSL certificate file if needed
+#include "request_engine.h"
+
+// Configuration settings - compile-time only, no runtime loading.
+// Every setting is a constant, so RequestEngine folds them into the request path and
+// drops the branches for features this build does not have.
+struct StaticConfig {
+    // Maximum number of key/value pairs accepted in one request
+    static constexpr unsigned int MAX_PARAMETERS = 10;
+
+    // Plain GET requests on this thread's pooled handle; CFResp=1 also returns the response,
+    // "Endpoint" is sent as "endpoint" and failures only matter with CFResp
+    static constexpr bool RUNTIME_FEATURES = false;
+    static constexpr bool CFRESP_ACCEPTS_ONE = true;
+    static constexpr bool LOWERCASE_ENDPOINT = true;
+    static constexpr bool FAIL_ONLY_WITH_CFRESP = true;
+
+    // Use the values passed to CMake at build time
+#ifdef STATIC_API_URL
+    static constexpr const char* baseUrl = STATIC_API_URL;
+    static constexpr std::string_view urlPrefix = STATIC_API_URL "?";
+#else
+    static constexpr const char* baseUrl = "https://192.168.102.55/testoscc.php";
+    static constexpr std::string_view urlPrefix = "https://192.168.102.55/testoscc.php?";
+#endif
+
+#ifdef DEFAULT_TIMEOUT
+    static constexpr long timeout = DEFAULT_TIMEOUT;
+#else
+    static constexpr long timeout = 4;
+#endif
+
+#ifdef DEFAULT_CONNECT_TIMEOUT
+    static constexpr long connectTimeout = DEFAULT_CONNECT_TIMEOUT;
+#else
+    static constexpr long connectTimeout = 2;
+#endif
+
+#ifdef STATIC_VERIFY_SSL
+    static constexpr bool verifySSL = STATIC_VERIFY_SSL; // STATIC_VERIFY_SSL=OFF ignores SSL certificate validation
+#else
+    static constexpr bool verifySSL = false;
+#endif
+
+#ifdef DEFAULT_SSL_CERT_FILE
+    static constexpr const char* sslCertFile = DEFAULT_SSL_CERT_FILE; // Path to SSL certificate file if needed
+#else
+    static constexpr const char* sslCertFile = "";
+#endif
+
+    static constexpr long maxIdleConnections = 2; // Idle connections kept by each thread's pooled handle
+    static constexpr long idleTimeout = 60; // Seconds before an idle pooled connection is dropped
+
+    // The settings never change, so every call uses the same constants
+    static constexpr StaticConfig Current() { return {}; }
+
+    // Options for one transfer with these settings
+    static constexpr TransferOptions GetTransferOptions() {
+        TransferOptions options;
+        options.timeout = timeout;
+        options.connectTimeout = connectTimeout;
+        options.idleTimeout = idleTimeout;
+        options.verifySSL = verifySSL;
+        options.sslCertFile = sslCertFile;
+        return options;
+    }
 };
 
-// Global configuration - initialized at compile time
-constexpr ConfigSettings CONFIG;
-
 // Global curl initialization mutex
 std::mutex curlInitMutex;
 bool curlGlobalInitialized = false;
@@ -54,6 +88,8 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD ul_reason_for_call, LPVOID lpReserve
     } else if (ul_reason_for_call == DLL_PROCESS_DETACH) {
         std::lock_guard<std::mutex> lock(curlInitMutex);
         if (curlGlobalInitialized) {
+            // Release pooled handles (and their connections) before global cleanup
+            CurlHandlePool::Shutdown();
             curl_global_cleanup();
             curlGlobalInitialized = false;
         }
@@ -61,33 +97,8 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD ul_reason_for_call, LPVOID lpReserve
     return TRUE;
 }
 
-// Callback function for curl to write response data
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp)
-{
-    const size_t totalSize = size * nmemb;
-    userp->append(static_cast<char*>(contents), totalSize);
-    return totalSize;
-}
-
-// URL encode a string
-std::string UrlEncode(const std::string& value, CURL* curl) {
-    char* encoded = curl_easy_escape(curl, value.c_str(), static_cast<int>(value.length()));
-    if (encoded) {
-        std::string result(encoded);
-        curl_free(encoded);
-        return result;
-    }
-    return value; // Return original if encoding fails
-}
-
-// Convert string to lowercase
-std::string ToLowerCase(const std::string& str) {
-    std::string result = str;
-    for (char& c : result) {
-        c = std::tolower(static_cast<unsigned char>(c));
-    }
-    return result;
-}
+// The request path, specialized for the compile-time configuration
+using Engine = RequestEngine<StaticConfig>;
 
 extern "C"
 {
@@ -98,214 +109,6 @@ extern "C"
 
     __declspec(dllexport) long ProcessContactCenterRequest(const char* dataIn, char* dataOut)
     {
-        try {
-            // Constants for parsing input/output
-            constexpr unsigned int HEADER_SIZE = 2;
-            constexpr unsigned int KEY_SIZE = 32;
-            constexpr unsigned int VALUE_SIZE = 128;
-            constexpr unsigned int PAIR_SIZE = KEY_SIZE + VALUE_SIZE;
-
-            // Ensure dataIn is not null
-            if (!dataIn) {
-                SetLastErrorMessage("Invalid input: dataIn is null");
-                return FAIL;
-            }
-
-            // Determine number of input parameters
-            char numParametersAsString[3] = {dataIn[0], dataIn[1], '\0'};
-            const unsigned int numParameters = atoi(numParametersAsString);
-
-            // Validate number of parameters
-            if (numParameters > 10) { // Arbitrary limit for safety
-                SetLastErrorMessage("Too many parameters: %d (maximum is 10)", numParameters);
-                return FAIL;
-            }
-
-            // Map to store key/value pairs
-            std::map<std::string, std::string> parameters;
-            bool shouldReturnResponse = false;
-
-            // Read each input parameter
-            for (unsigned int i = 0; i < numParameters; i++)
-            {
-                // Allocate on stack for better performance
-                char key[KEY_SIZE + 1] = {0};
-                char value[VALUE_SIZE + 1] = {0};
-
-                const unsigned int keyIndex = HEADER_SIZE + i * PAIR_SIZE;
-                const unsigned int valueIndex = keyIndex + KEY_SIZE;
-
-                // Copy key and value, ensuring null termination
-                memcpy(key, dataIn + keyIndex, KEY_SIZE);
-                memcpy(value, dataIn + valueIndex, VALUE_SIZE);
-
-                key[KEY_SIZE] = '\0';
-                value[VALUE_SIZE] = '\0';
-
-                // Create string_view first to avoid unnecessary string copies
-                // std::string_view automatically stops at the first null character
-                std::string_view keyView(key);
-
-                // For value, we can use strlen since we trust null-termination
-                size_t valueLength = strlen(value);
-                std::string_view valueView(value, valueLength);
-
-                // Convert to strings only when needed
-                std::string keyStr(keyView);
-                std::string valueStr(valueView);
-
-                // Store in map
-                parameters[keyStr] = valueStr;
-
-                // Check if CFResp is set to yes or 1
-                if (keyStr == "CFResp" && (valueStr == "yes" || valueStr == "1")) {
-                    shouldReturnResponse = true;
-                }
-            }
-
-            // Initialize curl
-            CURL* curl = curl_easy_init();
-            if (!curl) {
-                SetLastErrorMessage("Failed to initialize curl");
-                return FAIL;
-            }
-
-            // Use RAII to ensure curl cleanup
-            struct CurlCleanup {
-                CURL* curl;
-                CurlCleanup(CURL* c) : curl(c) {}
-                ~CurlCleanup() { if (curl) curl_easy_cleanup(curl); }
-            } curlGuard(curl);
-
-            // Construct URL for GET request with proper encoding
-            std::string url = CONFIG.baseUrl;
-            url += "?";
-            bool firstParam = true;
-
-            // Reserve space for URL to avoid reallocations
-            url.reserve(256);
-
-            for (const auto& [key, value] : parameters) {
-                // Skip CFResp parameter in URL
-                if (key == "CFResp") {
-                    continue;
-                }
-
-                if (!firstParam) {
-                    url += "&";
-                }
-
-                // Convert "Endpoint" to lowercase "endpoint" for compatibility
-                std::string normalizedKey = key;
-                if (ToLowerCase(normalizedKey) == "endpoint") {
-                    normalizedKey = "endpoint";
-                }
-
-                // URL encode both key and value
-                url += normalizedKey + "=" + UrlEncode(value, curl);
-                firstParam = false;
-            }
-
-            // Initialize response string with reasonable capacity
-            std::string responseData;
-            responseData.reserve(1024);
-
-            // Set URL
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-
-            // Set timeout from configuration
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, CONFIG.timeout);
-
-            // Set connection timeout from configuration
-            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, CONFIG.connectTimeout);
-
-            // Follow redirects
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
-
-            // Enable TCP keepalive
-            curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
-
-            // Use HTTP/1.1
-            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-
-            // Set write callback function
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseData);
-
-            // Configure SSL options
-            if (!CONFIG.verifySSL) {
-                // Disable SSL certificate verification
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-            } else if (CONFIG.sslCertFile && CONFIG.sslCertFile[0] != '\0') {
-                // Use custom certificate file
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-                curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-                curl_easy_setopt(curl, CURLOPT_CAINFO, CONFIG.sslCertFile);
-            }
-
-            // Perform the request
-            CURLcode res = curl_easy_perform(curl);
-
-            // Check for errors
-            if (res != CURLE_OK) {
-                SetLastErrorMessage("Curl request failed: %s", curl_easy_strerror(res));
-                // Only return FAIL if we need to return a response (CFResp=yes)
-                // Otherwise, we don't care about the CURL errors
-                if (shouldReturnResponse) {
-                    return FAIL;
-                }
-            }
-
-            // Get HTTP response code
-            long httpCode = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
-
-            // Check if HTTP response is successful (200-299)
-            if (httpCode < 200 || httpCode >= 300) {
-                SetLastErrorMessage("HTTP error: received status code %ld", httpCode);
-                // Only return FAIL if we need to return a response (CFResp=yes)
-                // Otherwise, we don't care about the HTTP response
-                if (shouldReturnResponse) {
-                    return FAIL;
-                }
-                // If CFResp is not "yes", we don't care about the HTTP response
-                // and should return SUCCESS
-            }
-
-            // If CFResp=yes was in the input, return the response
-            if (shouldReturnResponse && dataOut) {
-                // Set number of output parameters to 1
-                dataOut[0] = '0';
-                dataOut[1] = '1';
-
-                // Prepare output key/value
-                char outputKey[KEY_SIZE] = {0};
-                char outputValue[VALUE_SIZE] = {0};
-
-                // Set key to "CFResp"
-                strncpy(outputKey, "CFResp", KEY_SIZE - 1);
-
-                // Copy response data to output value (truncate if too long)
-                strncpy(outputValue, responseData.c_str(), VALUE_SIZE - 1);
-
-                // Write to output buffer
-                memcpy(dataOut + HEADER_SIZE, outputKey, KEY_SIZE);
-                memcpy(dataOut + HEADER_SIZE + KEY_SIZE, outputValue, VALUE_SIZE);
-            }
-
-            return SUCCESS; // Success
-        }
-        catch (const std::exception& e) {
-            // Catch standard exceptions
-            SetLastErrorMessage("Unexpected exception: %s", e.what());
-            return FAIL;
-        }
-        catch (...) {
-            // Catch any other unexpected exceptions
-            SetLastErrorMessage("Unknown exception occurred");
-            return FAIL;
-        }
+        return Engine::Handle(dataIn, dataOut);
     }
 }
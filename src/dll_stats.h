@@ -0,0 +1,229 @@
+#ifndef DLL_STATS_H
+#define DLL_STATS_H
+
+#include <curl/curl.h>
+#include <atomic>
+
+#include "custom_dll.h"
+#include "io_engine.h"
+
+// Latency histogram with the bucket layout described in custom_dll.h.
+// Recording is a handful of relaxed atomic increments, so routing threads never
+// contend on a lock; a snapshot may be mid-update by a few counts, which is fine
+// for monitoring.
+class AtomicHistogram {
+public:
+    void Record(long long micros) {
+        const unsigned long long value = micros > 0 ? static_cast<unsigned long long>(micros) : 0;
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumMicros.fetch_add(value, std::memory_order_relaxed);
+        buckets[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+
+        unsigned long long current = maxMicros.load(std::memory_order_relaxed);
+        while (value > current &&
+               !maxMicros.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    void CopyTo(LatencyHistogram& out) const {
+        out.count = count.load(std::memory_order_relaxed);
+        out.sumMicros = sumMicros.load(std::memory_order_relaxed);
+        out.maxMicros = maxMicros.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < DLL_STATS_LATENCY_BUCKETS; i++) {
+            out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Bucket of a value: exact below 8, then 8 linear sub-buckets per power of two
+    static unsigned int BucketFor(unsigned long long value) {
+        if (value < 8) {
+            return static_cast<unsigned int>(value);
+        }
+        unsigned int msb = 3;
+        while (msb < 63 && (value >> (msb + 1)) != 0) {
+            msb++;
+        }
+        const unsigned long long index = (msb - 2) * 8ULL + ((value >> (msb - 3)) - 8);
+        return index < DLL_STATS_LATENCY_BUCKETS ? static_cast<unsigned int>(index)
+                                                 : DLL_STATS_LATENCY_BUCKETS - 1;
+    }
+
+private:
+    std::atomic<unsigned long long> count{0};
+    std::atomic<unsigned long long> sumMicros{0};
+    std::atomic<unsigned long long> maxMicros{0};
+    std::atomic<unsigned long long> buckets[DLL_STATS_LATENCY_BUCKETS] = {};
+};
+
+// A percentile of recent transfer times.
+//
+// Samples go into a histogram with the AtomicHistogram layout. At most once per second
+// one caller recomputes the percentile and then halves every bucket, so older samples
+// fade out and the value follows the latest traffic. Until MIN_SAMPLES have been seen
+// there is no value; after that a quiet period keeps the last one.
+class RecentPercentile {
+public:
+    explicit RecentPercentile(unsigned int percent) : percent(percent) {}
+
+    void Record(long long micros) {
+        buckets[AtomicHistogram::BucketFor(micros > 0 ? static_cast<unsigned long long>(micros) : 0)]
+            .fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The percentile in microseconds, recomputed when due (0 until there are enough samples)
+    unsigned long long Current(long long nowMs) {
+        long long due = nextUpdateMs.load(std::memory_order_relaxed);
+        if (nowMs >= due &&
+            nextUpdateMs.compare_exchange_strong(due, nowMs + UPDATE_INTERVAL_MS, std::memory_order_relaxed)) {
+            Update();
+        }
+        return currentMicros.load(std::memory_order_relaxed);
+    }
+
+    // The last computed percentile in microseconds, without recomputing it
+    unsigned long long Last() const {
+        return currentMicros.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr long long UPDATE_INTERVAL_MS = 1000;
+    static constexpr unsigned long long MIN_SAMPLES = 100;
+
+    // Lowest value in bucket index (the inverse of AtomicHistogram::BucketFor)
+    static unsigned long long BucketLowerBound(unsigned int index) {
+        if (index < 8) {
+            return index;
+        }
+        return (8ULL + index % 8) << (index / 8 - 1);
+    }
+
+    void Update() {
+        unsigned long long counts[DLL_STATS_LATENCY_BUCKETS];
+        unsigned long long total = 0;
+        for (unsigned int i = 0; i < DLL_STATS_LATENCY_BUCKETS; i++) {
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total < MIN_SAMPLES) {
+            return;
+        }
+
+        // Upper edge of the bucket holding the percentile
+        const unsigned long long target = total - total * (100 - percent) / 100;
+        unsigned long long seen = 0;
+        unsigned int index = 0;
+        for (; index < DLL_STATS_LATENCY_BUCKETS - 1; index++) {
+            seen += counts[index];
+            if (seen >= target) {
+                break;
+            }
+        }
+        currentMicros.store(BucketLowerBound(index + 1), std::memory_order_relaxed);
+
+        // Decay: halve the samples so the estimate follows recent traffic
+        for (unsigned int i = 0; i < DLL_STATS_LATENCY_BUCKETS; i++) {
+            if (counts[i] > 0) {
+                buckets[i].fetch_sub(counts[i] - counts[i] / 2, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const unsigned int percent;
+    std::atomic<unsigned long long> buckets[DLL_STATS_LATENCY_BUCKETS] = {};
+    std::atomic<long long> nextUpdateMs{0};
+    std::atomic<unsigned long long> currentMicros{0};
+};
+
+// Process-wide call metrics behind GetDllStats
+class DllMetrics {
+public:
+    void RecordCall(bool success) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        (success ? successes : failures).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Outcome of a request this caller sent to the backend (not a cache hit or a coalesced wait)
+    void RecordTransfer(CURLcode result, long httpCode, const TransferTimings& timings) {
+        transfers.fetch_add(1, std::memory_order_relaxed);
+
+        if (result != CURLE_OK) {
+            const unsigned int code = static_cast<unsigned int>(result) < DLL_STATS_CURL_CODES
+                ? static_cast<unsigned int>(result) : DLL_STATS_CURL_CODES - 1;
+            curlErrors[code].fetch_add(1, std::memory_order_relaxed);
+            if (result == CURLE_OPERATION_TIMEDOUT) {
+                timeouts.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (httpCode < 200 || httpCode >= 300) {
+            if (httpCode >= 100 && httpCode < 200) {
+                http1xx.fetch_add(1, std::memory_order_relaxed);
+            } else if (httpCode >= 300 && httpCode < 400) {
+                http3xx.fetch_add(1, std::memory_order_relaxed);
+            } else if (httpCode >= 400 && httpCode < 500) {
+                http4xx.fetch_add(1, std::memory_order_relaxed);
+            } else if (httpCode >= 500 && httpCode < 600) {
+                http5xx.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                httpOther.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (timings.valid) {
+            // Lookup, connect and handshake only happen on a new connection
+            if (timings.newConnection) {
+                dns.Record(timings.nameLookup);
+                connect.Record(timings.connect);
+                if (timings.appConnect > 0) {
+                    tls.Record(timings.appConnect);
+                }
+            }
+            total.Record(timings.total);
+        }
+    }
+
+    void RecordTruncated() {
+        truncatedResponses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Fill the counters owned by this class (the caller adds async, cache and coalescing counters)
+    void CopyTo(DllStats& out) const {
+        out.version = DLL_STATS_VERSION;
+        out.calls = calls.load(std::memory_order_relaxed);
+        out.successes = successes.load(std::memory_order_relaxed);
+        out.failures = failures.load(std::memory_order_relaxed);
+        out.transfers = transfers.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < DLL_STATS_CURL_CODES; i++) {
+            out.curlErrors[i] = curlErrors[i].load(std::memory_order_relaxed);
+        }
+        out.timeouts = timeouts.load(std::memory_order_relaxed);
+        out.http1xx = http1xx.load(std::memory_order_relaxed);
+        out.http3xx = http3xx.load(std::memory_order_relaxed);
+        out.http4xx = http4xx.load(std::memory_order_relaxed);
+        out.http5xx = http5xx.load(std::memory_order_relaxed);
+        out.httpOther = httpOther.load(std::memory_order_relaxed);
+        out.truncatedResponses = truncatedResponses.load(std::memory_order_relaxed);
+        dns.CopyTo(out.dns);
+        connect.CopyTo(out.connect);
+        tls.CopyTo(out.tls);
+        total.CopyTo(out.total);
+    }
+
+private:
+    std::atomic<unsigned long long> calls{0};
+    std::atomic<unsigned long long> successes{0};
+    std::atomic<unsigned long long> failures{0};
+    std::atomic<unsigned long long> transfers{0};
+    std::atomic<unsigned long long> curlErrors[DLL_STATS_CURL_CODES] = {};
+    std::atomic<unsigned long long> timeouts{0};
+    std::atomic<unsigned long long> http1xx{0};
+    std::atomic<unsigned long long> http3xx{0};
+    std::atomic<unsigned long long> http4xx{0};
+    std::atomic<unsigned long long> http5xx{0};
+    std::atomic<unsigned long long> httpOther{0};
+    std::atomic<unsigned long long> truncatedResponses{0};
+    AtomicHistogram dns;
+    AtomicHistogram connect;
+    AtomicHistogram tls;
+    AtomicHistogram total;
+};
+
+#endif // DLL_STATS_H
@@ -0,0 +1,752 @@
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "module_pin.h"
+
+// Per-request curl options shared by the synchronous and asynchronous paths.
+// sslCertFile, caBundle and resolve must stay valid until the transfer completes; they point
+// into a configuration snapshot (kept until the DLL unloads) or static data.
+struct TransferOptions {
+    long timeout = 4;
+    long timeoutMs = 0;               // Overrides timeout when set (adaptive timeout)
+    long connectTimeout = 2;
+    long idleTimeout = 60;
+    bool verifySSL = true;
+    const char* sslCertFile = "";
+    bool http2 = false;
+    const curl_blob* caBundle = nullptr; // CA certificates already in memory (preferred over sslCertFile)
+    CURLSH* share = nullptr;          // Shared DNS/TLS session cache, nullptr for per-handle caches
+    curl_slist* resolve = nullptr;    // Pinned host:port:address entries
+    long dnsCacheTimeout = 60;        // Seconds a resolved name is reused
+    long happyEyeballsTimeoutMs = 0;  // Head start for IPv6 before IPv4 is tried (0 = libcurl default)
+    long ipResolve = CURL_IPRESOLVE_WHATEVER;
+    bool headOnly = false;            // Send a HEAD request (connection warm-up)
+};
+
+// Apply the standard request options to an easy handle
+inline void ApplyTransferOptions(CURL* curl, const char* url, const TransferOptions& options) {
+    // Set URL
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+
+    // Set timeout from configuration
+    if (options.timeoutMs > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, options.timeoutMs);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, options.timeout);
+    }
+
+    // Set connection timeout from configuration
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connectTimeout);
+
+    // Drop pooled connections that have been idle too long
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, options.idleTimeout);
+
+    // Resolve through the shared DNS cache, with any pinned addresses preloaded
+    if (options.share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, options.share);
+    }
+    if (options.resolve) {
+        curl_easy_setopt(curl, CURLOPT_RESOLVE, options.resolve);
+    }
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, options.dnsCacheTimeout);
+
+    // Connect tuning for dual-stack backends
+    curl_easy_setopt(curl, CURLOPT_IPRESOLVE, options.ipResolve);
+    if (options.happyEyeballsTimeoutMs > 0) {
+        curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, options.happyEyeballsTimeoutMs);
+    }
+
+    // Ask for the headers only
+    if (options.headOnly) {
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    }
+
+    // Follow redirects
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 3L);
+
+    // Enable TCP keepalive
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // Negotiate HTTP/2 over TLS when enabled (falls back to HTTP/1.1 if the backend or libcurl lacks it)
+    if (options.http2 && curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS) == CURLE_OK) {
+        // Wait for an existing connection that can multiplex instead of opening a new one
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    } else {
+        // Use HTTP/1.1
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    }
+
+    // Configure SSL options
+    if (!options.verifySSL) {
+        // Disable SSL certificate verification
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    } else if (options.caBundle) {
+        // Use the custom certificates loaded once from the certificate file
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+        curl_easy_setopt(curl, CURLOPT_CAINFO_BLOB, options.caBundle);
+    } else if (options.sslCertFile && options.sslCertFile[0] != '\0') {
+        // Use custom certificate file
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+        curl_easy_setopt(curl, CURLOPT_CAINFO, options.sslCertFile);
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x075700
+    // Keep the parsed CA store between handshakes (OpenSSL backend)
+    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, 86400L);
+#endif
+}
+
+// Body of a POST request; GET requests leave post unset and data empty
+struct RequestBody {
+    bool post = false;
+    std::string data;
+    const curl_slist* headers = nullptr; // Content-Type and Content-Encoding of data, and the trace header
+};
+
+// Send body as the request's POST data, and its headers with any request
+// (both must stay valid until the transfer completes)
+inline void ApplyRequestBody(CURL* curl, const RequestBody& body) {
+    if (body.headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, const_cast<curl_slist*>(body.headers));
+    }
+    if (!body.post) {
+        return;
+    }
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body.data.size()));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data.data());
+}
+
+// Phase durations of a finished transfer in microseconds, read from curl.
+// Each phase is measured from the end of the previous one; a reused connection
+// has no lookup, connect or handshake, so newConnection tells them apart.
+struct TransferTimings {
+    bool valid = false;
+    bool newConnection = false;
+    long long nameLookup = 0;    // Resolving the host name
+    long long connect = 0;       // TCP connect after the lookup
+    long long appConnect = 0;    // TLS handshake after the connect (0 for plain HTTP)
+    long long waiting = 0;       // From the end of the handshake to the first response byte
+    long long total = 0;         // Whole transfer, including redirects
+};
+
+// Collect the timing breakdown of the last transfer on an easy handle
+inline TransferTimings ReadTransferTimings(CURL* curl) {
+    TransferTimings timings;
+    curl_off_t nameLookup = 0;
+    curl_off_t connect = 0;
+    curl_off_t appConnect = 0;
+    curl_off_t startTransfer = 0;
+    curl_off_t total = 0;
+    long newConnections = 0;
+    if (curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total) != CURLE_OK) {
+        return timings;
+    }
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &startTransfer);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnections);
+
+    // curl reports cumulative times from the start of the transfer
+    timings.valid = true;
+    timings.newConnection = newConnections > 0;
+    timings.nameLookup = nameLookup;
+    timings.connect = connect > nameLookup ? connect - nameLookup : 0;
+    timings.appConnect = appConnect > connect ? appConnect - connect : 0;
+    const curl_off_t connected = appConnect > connect ? appConnect : connect;
+    timings.waiting = startTransfer > connected ? startTransfer - connected : 0;
+    timings.total = total;
+    return timings;
+}
+
+// Custom destination for a response body, used instead of collecting it in a string.
+// write follows the CURLOPT_WRITEFUNCTION contract: returning less than it was given
+// aborts the transfer with CURLE_WRITE_ERROR.
+struct BodySink {
+    curl_write_callback write = nullptr;
+    void* userdata = nullptr;
+};
+
+// What to do when the async queue is full
+enum class OverflowPolicy {
+    Block, // Wait for space, up to the request timeout
+    Drop,  // Discard the request and report success
+    Fail   // Reject the request and report failure
+};
+
+// Completion object a synchronous caller waits on (lives on the caller's stack).
+// Written by the worker thread; fields are read only after done is set.
+struct TransferCompletion {
+    std::string* responseData = nullptr;
+    BodySink sink;                    // Receives the body instead of responseData when set
+    CURLcode result = CURLE_OK;
+    long httpCode = 0;
+    TransferTimings timings;
+    bool done = false;
+    std::condition_variable finished;
+    std::condition_variable* batchFinished = nullptr; // Notified instead of finished for batch members
+};
+
+// A request handed to the background I/O thread
+struct AsyncRequest {
+    std::string url;
+    TransferOptions options;
+    TransferCompletion* completion = nullptr; // nullptr for fire-and-forget
+    RequestBody body;
+};
+
+// Shared I/O engine.
+//
+// A single worker thread drives a curl_multi handle for every caller in the process.
+// Synchronous callers submit a request and wait on a per-call completion object;
+// fire-and-forget callers enqueue into a bounded queue and return immediately. All
+// transfers share the multi handle's connection cache, and with HTTP/2 enabled they
+// are multiplexed over a few connections instead of one socket per routing thread.
+// Easy handles are recycled by the worker. The worker is started lazily by the first
+// request (never from DllMain).
+class IoEngine {
+public:
+    struct Limits {
+        size_t queueCapacity;     // Fire-and-forget requests waiting for the worker
+        size_t maxInFlight;       // Concurrent fire-and-forget transfers
+        long maxIdleConnections;  // CURLMOPT_MAXCONNECTS
+        long maxHostConnections;  // CURLMOPT_MAX_HOST_CONNECTIONS (0 = unlimited)
+    };
+
+    enum class SubmitResult {
+        Queued,
+        Dropped,  // Queue full, discarded (Drop policy)
+        Rejected  // Queue full or engine stopped (Block/Fail policy)
+    };
+
+    // Fire-and-forget delivery counters, updated without locks
+    struct Counters {
+        std::atomic<unsigned long long> queued{0};
+        std::atomic<unsigned long long> delivered{0};
+        std::atomic<unsigned long long> failed{0};   // curl error or non-2xx status
+        std::atomic<unsigned long long> dropped{0};  // Queue full (Drop policy)
+        std::atomic<unsigned long long> rejected{0}; // Queue full (Block/Fail policy)
+    };
+
+    // Process-wide engine (intentionally never destroyed, see Shutdown)
+    static IoEngine& Instance() {
+        static IoEngine* engine = new IoEngine();
+        return *engine;
+    }
+
+    // Queue a fire-and-forget request for delivery by the worker thread
+    SubmitResult Submit(AsyncRequest&& request, OverflowPolicy overflow, const Limits& limits) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping || !EnsureStarted(limits)) {
+            counters.rejected.fetch_add(1, std::memory_order_relaxed);
+            return SubmitResult::Rejected;
+        }
+        currentLimits = limits;
+
+        if (asyncQueue.size() >= limits.queueCapacity) {
+            if (overflow == OverflowPolicy::Drop) {
+                counters.dropped.fetch_add(1, std::memory_order_relaxed);
+                return SubmitResult::Dropped;
+            }
+
+            const bool hasSpace = overflow == OverflowPolicy::Block &&
+                spaceAvailable.wait_for(lock, std::chrono::seconds(request.options.timeout), [&] {
+                    return stopping || asyncQueue.size() < currentLimits.queueCapacity;
+                }) && !stopping;
+
+            if (!hasSpace) {
+                counters.rejected.fetch_add(1, std::memory_order_relaxed);
+                return SubmitResult::Rejected;
+            }
+        }
+
+        request.completion = nullptr;
+        asyncQueue.push_back(std::move(request));
+        counters.queued.fetch_add(1, std::memory_order_relaxed);
+        curl_multi_wakeup(multi);
+        return SubmitResult::Queued;
+    }
+
+    // Run a request on the worker thread and block until it completes.
+    // Synchronous requests go ahead of queued fire-and-forget ones and are not limited
+    // by maxInFlight (the number of calling threads already bounds them). If the request
+    // is still waiting to start when its timeout (timeoutMs when set) elapses it is
+    // withdrawn and reported as CURLE_OPERATION_TIMEDOUT; once started, curl's own
+    // timeout bounds it.
+    // timings, when given, receives the transfer's curl timing breakdown; sink, when given,
+    // receives the body instead of responseData.
+    CURLcode Perform(const std::string& url, const RequestBody& body, const TransferOptions& options,
+                     const Limits& limits, std::string& responseData, long& httpCode,
+                     TransferTimings* timings = nullptr, const BodySink* sink = nullptr) {
+        TransferCompletion completion;
+        completion.responseData = &responseData;
+        if (sink) {
+            completion.sink = *sink;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping || !EnsureStarted(limits)) {
+            return CURLE_FAILED_INIT;
+        }
+        syncQueue.push_back({url, options, &completion, body});
+        curl_multi_wakeup(multi);
+
+        auto isDone = [&] { return completion.done; };
+        const long timeoutMs = options.timeoutMs > 0 ? options.timeoutMs : options.timeout * 1000;
+        if (timeoutMs <= 0) {
+            completion.finished.wait(lock, isDone);
+        } else if (!completion.finished.wait_for(lock, std::chrono::milliseconds(timeoutMs), isDone)) {
+            auto queued = std::find_if(syncQueue.begin(), syncQueue.end(),
+                                       [&](const AsyncRequest& r) { return r.completion == &completion; });
+            if (queued != syncQueue.end()) {
+                syncQueue.erase(queued);
+                return CURLE_OPERATION_TIMEDOUT;
+            }
+            completion.finished.wait(lock, isDone);
+        }
+
+        httpCode = completion.httpCode;
+        if (timings) {
+            *timings = completion.timings;
+        }
+        return completion.result;
+    }
+
+    // One copy of a hedged request; filled in by PerformHedged
+    struct HedgeCopy {
+        std::string responseData;
+        CURLcode result = CURLE_OK;
+        long httpCode = 0;
+        TransferTimings timings;
+        bool sent = false;      // The copy went to the worker
+        bool cancelled = false; // The other copy won first and this one was withdrawn
+    };
+
+    // Run a request on the worker thread like Perform, and if it has not finished after
+    // hedgeDelay send the same request to hedgeUrl too. The first copy to succeed wins
+    // and the other is cancelled; if neither succeeds, the one that finished last is
+    // used. Returns the index in copies of the copy to use. Meant for idempotent requests.
+    size_t PerformHedged(const std::string& url, const std::string& hedgeUrl, const RequestBody& body,
+                         const TransferOptions& options, std::chrono::milliseconds hedgeDelay,
+                         const Limits& limits, HedgeCopy (&copies)[2]) {
+        std::condition_variable anyFinished;
+        TransferCompletion completions[2];
+        for (size_t i = 0; i < 2; i++) {
+            completions[i].responseData = &copies[i].responseData;
+            completions[i].batchFinished = &anyFinished;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        copies[0].sent = true;
+        if (stopping || !EnsureStarted(limits)) {
+            copies[0].result = CURLE_FAILED_INIT;
+            return 0;
+        }
+        syncQueue.push_back({url, options, &completions[0], body});
+        curl_multi_wakeup(multi);
+
+        // Give the first copy hedgeDelay on its own
+        if (!anyFinished.wait_for(lock, hedgeDelay, [&] { return completions[0].done; }) && !stopping) {
+            syncQueue.push_back({hedgeUrl, options, &completions[1], body});
+            copies[1].sent = true;
+            curl_multi_wakeup(multi);
+        }
+
+        // Wait for a success, or for every copy that was sent
+        auto succeeded = [&](size_t i) {
+            return completions[i].done && completions[i].result == CURLE_OK && completions[i].httpCode < 500;
+        };
+        anyFinished.wait(lock, [&] {
+            return succeeded(0) || succeeded(1) || (completions[0].done && (!copies[1].sent || completions[1].done));
+        });
+        const size_t winner = succeeded(0) ? 0 : succeeded(1) ? 1 : (copies[1].sent ? 1 : 0);
+
+        // Withdraw the losing copy if it is still running; its completion lives on this stack
+        const size_t loser = 1 - winner;
+        if (copies[loser].sent && !completions[loser].done) {
+            copies[loser].cancelled = true;
+            auto queued = std::find_if(syncQueue.begin(), syncQueue.end(),
+                                       [&](const AsyncRequest& r) { return r.completion == &completions[loser]; });
+            if (queued != syncQueue.end()) {
+                syncQueue.erase(queued);
+                completions[loser].result = CURLE_ABORTED_BY_CALLBACK;
+                completions[loser].done = true;
+            } else {
+                cancelRequests.push_back(&completions[loser]);
+                curl_multi_wakeup(multi);
+                anyFinished.wait(lock, [&] { return completions[loser].done; });
+
+                // If it finished on its own before the worker took the cancel request, take
+                // the request back: a later transfer may report to this stack address
+                cancelRequests.erase(std::remove(cancelRequests.begin(), cancelRequests.end(), &completions[loser]),
+                                     cancelRequests.end());
+            }
+        }
+
+        for (size_t i = 0; i < 2; i++) {
+            copies[i].result = completions[i].result;
+            copies[i].httpCode = completions[i].httpCode;
+            copies[i].timings = completions[i].timings;
+        }
+        return winner;
+    }
+
+    // One request of a batch; result, httpCode, timings and responseData are filled in by PerformBatch
+    struct BatchTransfer {
+        std::string url;
+        RequestBody body;
+        TransferOptions options;
+        std::string responseData;
+        BodySink sink;                // Receives the body instead of responseData when set
+        CURLcode result = CURLE_OK;
+        long httpCode = 0;
+        TransferTimings timings;
+    };
+
+    // Run a batch of requests on the worker thread and block until all have completed.
+    // At most maxConcurrent of them are on the multi handle at once; as each finishes the
+    // next one is queued, so the window stays full. Like Perform, batch members go ahead
+    // of fire-and-forget requests and curl's own timeout bounds each transfer. Requests
+    // not yet queued when the engine stops are reported as CURLE_ABORTED_BY_CALLBACK.
+    void PerformBatch(std::vector<BatchTransfer>& batch, const Limits& limits, size_t maxConcurrent) {
+        if (batch.empty()) {
+            return;
+        }
+        maxConcurrent = std::max<size_t>(maxConcurrent, 1);
+
+        std::condition_variable batchFinished;
+        std::deque<TransferCompletion> completions(batch.size());
+        std::vector<size_t> inFlight;
+        inFlight.reserve(std::min(maxConcurrent, batch.size()));
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping || !EnsureStarted(limits)) {
+            for (BatchTransfer& transfer : batch) {
+                transfer.result = CURLE_FAILED_INIT;
+            }
+            return;
+        }
+
+        size_t next = 0;
+        while (next < batch.size() || !inFlight.empty()) {
+            // Top up the window
+            bool queued = false;
+            while (next < batch.size() && inFlight.size() < maxConcurrent) {
+                if (stopping) {
+                    batch[next++].result = CURLE_ABORTED_BY_CALLBACK;
+                    continue;
+                }
+                TransferCompletion& completion = completions[next];
+                completion.responseData = &batch[next].responseData;
+                completion.sink = batch[next].sink;
+                completion.batchFinished = &batchFinished;
+                syncQueue.push_back({batch[next].url, batch[next].options, &completion, batch[next].body});
+                inFlight.push_back(next++);
+                queued = true;
+            }
+            if (queued) {
+                curl_multi_wakeup(multi);
+            }
+            if (inFlight.empty()) {
+                break;
+            }
+
+            // Wait for any transfer in the window and collect every one that is done
+            batchFinished.wait(lock, [&] {
+                return std::any_of(inFlight.begin(), inFlight.end(),
+                                   [&](size_t index) { return completions[index].done; });
+            });
+            size_t kept = 0;
+            for (size_t index : inFlight) {
+                const TransferCompletion& completion = completions[index];
+                if (!completion.done) {
+                    inFlight[kept++] = index;
+                    continue;
+                }
+                batch[index].result = completion.result;
+                batch[index].httpCode = completion.httpCode;
+                batch[index].timings = completion.timings;
+            }
+            inFlight.resize(kept);
+        }
+    }
+
+    // Stop accepting requests, let the worker drain for up to drainTimeout and join it.
+    // Returns false if the worker is still running after that (its handles still use the
+    // share handle); calling it again waits again.
+    bool Shutdown(std::chrono::milliseconds drainTimeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!stopping) {
+            stopping = true;
+            drainDeadline = std::chrono::steady_clock::now() + drainTimeout;
+            if (multi) {
+                curl_multi_wakeup(multi);
+            }
+            spaceAvailable.notify_all();
+        }
+        if (!worker.joinable()) {
+            return true;
+        }
+
+        if (!workerStopped.wait_for(lock, drainTimeout + std::chrono::seconds(1), [&] { return finished; })) {
+            return false;
+        }
+        lock.unlock();
+        worker.join();
+        return true;
+    }
+
+    const Counters& GetCounters() const { return counters; }
+
+private:
+    // One transfer on the multi handle
+    struct Transfer {
+        CURL* easy;
+        AsyncRequest request;
+    };
+
+    IoEngine() = default;
+
+    // Collect the body for synchronous callers; fire-and-forget responses are discarded
+    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        const size_t totalSize = size * nmemb;
+        Transfer* transfer = static_cast<Transfer*>(userp);
+        if (transfer->request.completion && transfer->request.completion->responseData) {
+            transfer->request.completion->responseData->append(static_cast<char*>(contents), totalSize);
+        }
+        return totalSize;
+    }
+
+    // Create the multi handle and worker thread on first use (caller holds mutex)
+    bool EnsureStarted(const Limits& limits) {
+        if (worker.joinable()) {
+            return true;
+        }
+        multi = curl_multi_init();
+        if (!multi) {
+            return false;
+        }
+        curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, limits.maxIdleConnections);
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, limits.maxHostConnections);
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        currentLimits = limits;
+        ModulePin::Acquire();
+        worker = std::thread(&IoEngine::Run, this);
+        return true;
+    }
+
+    // Put one request on the multi handle
+    bool StartTransfer(AsyncRequest&& request, std::vector<CURL*>& idleHandles,
+                       std::vector<CURL*>& activeHandles) {
+        CURL* easy = nullptr;
+        if (!idleHandles.empty()) {
+            easy = idleHandles.back();
+            idleHandles.pop_back();
+            curl_easy_reset(easy);
+        } else {
+            easy = curl_easy_init();
+            if (!easy) {
+                return false;
+            }
+        }
+
+        Transfer* transfer = new Transfer{easy, std::move(request)};
+        ApplyTransferOptions(easy, transfer->request.url.c_str(), transfer->request.options);
+        ApplyRequestBody(easy, transfer->request.body);
+        const TransferCompletion* completion = transfer->request.completion;
+        if (completion && completion->sink.write) {
+            curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, completion->sink.write);
+            curl_easy_setopt(easy, CURLOPT_WRITEDATA, completion->sink.userdata);
+        } else {
+            curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+        }
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+        curl_multi_add_handle(multi, easy);
+        activeHandles.push_back(easy);
+        return true;
+    }
+
+    // Move queued requests onto the multi handle (caller holds mutex)
+    void StartQueuedTransfers(std::vector<CURL*>& idleHandles, std::vector<CURL*>& activeHandles) {
+        while (!syncQueue.empty()) {
+            if (!StartTransfer(std::move(syncQueue.front()), idleHandles, activeHandles)) {
+                return;
+            }
+            syncQueue.pop_front();
+        }
+
+        bool started = false;
+        while (!asyncQueue.empty() && activeAsync < currentLimits.maxInFlight) {
+            if (!StartTransfer(std::move(asyncQueue.front()), idleHandles, activeHandles)) {
+                break;
+            }
+            asyncQueue.pop_front();
+            activeAsync++;
+            started = true;
+        }
+        if (started) {
+            spaceAvailable.notify_all();
+        }
+    }
+
+    // Wake the caller waiting on a completion (caller holds mutex)
+    static void NotifyFinished(TransferCompletion& completion) {
+        if (completion.batchFinished) {
+            completion.batchFinished->notify_one();
+        } else {
+            completion.finished.notify_one();
+        }
+    }
+
+    // Record the outcome of a finished transfer, wake its caller and recycle the handle
+    void FinishTransfer(CURL* easy, CURLcode result, std::vector<CURL*>& idleHandles,
+                        std::vector<CURL*>& activeHandles) {
+        Transfer* transfer = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+
+        long httpCode = 0;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &httpCode);
+
+        curl_multi_remove_handle(multi, easy);
+        activeHandles.erase(std::find(activeHandles.begin(), activeHandles.end(), easy));
+        idleHandles.push_back(easy);
+
+        if (TransferCompletion* completion = transfer->request.completion) {
+            const TransferTimings timings = ReadTransferTimings(easy);
+            std::lock_guard<std::mutex> lock(mutex);
+            completion->result = result;
+            completion->httpCode = httpCode;
+            completion->timings = timings;
+            completion->done = true;
+            NotifyFinished(*completion);
+        } else {
+            if (result == CURLE_OK && httpCode >= 200 && httpCode < 300) {
+                counters.delivered.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                counters.failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            activeAsync--;
+        }
+        delete transfer;
+    }
+
+    // Stop the running transfer that reports to completion, if it has not finished yet
+    void CancelTransfer(const TransferCompletion* completion, std::vector<CURL*>& idleHandles,
+                        std::vector<CURL*>& activeHandles) {
+        for (CURL* easy : activeHandles) {
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+            if (transfer->request.completion == completion) {
+                FinishTransfer(easy, CURLE_ABORTED_BY_CALLBACK, idleHandles, activeHandles);
+                return;
+            }
+        }
+    }
+
+    // Worker thread: drive the multi handle until stopped and drained
+    void Run() {
+        std::vector<CURL*> idleHandles;
+        std::vector<CURL*> activeHandles;
+        std::vector<TransferCompletion*> cancelled;
+
+        for (;;) {
+            int pollMs = 1000;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const auto now = std::chrono::steady_clock::now();
+                const bool pastDeadline = stopping && now >= drainDeadline;
+                if (!pastDeadline) {
+                    StartQueuedTransfers(idleHandles, activeHandles);
+                }
+                if (stopping && (pastDeadline ||
+                                 (syncQueue.empty() && asyncQueue.empty() && activeHandles.empty()))) {
+                    break;
+                }
+                cancelled.swap(cancelRequests);
+
+                // Wake up at the drain deadline to abandon what is left
+                if (stopping) {
+                    const auto untilDeadline =
+                        std::chrono::duration_cast<std::chrono::milliseconds>(drainDeadline - now).count() + 1;
+                    pollMs = static_cast<int>(std::min<long long>(pollMs, untilDeadline));
+                }
+            }
+
+            // Drop the losing copies of hedged requests
+            for (const TransferCompletion* completion : cancelled) {
+                CancelTransfer(completion, idleHandles, activeHandles);
+            }
+            cancelled.clear();
+
+            int running = 0;
+            curl_multi_perform(multi, &running);
+
+            int remaining = 0;
+            while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+                if (message->msg == CURLMSG_DONE) {
+                    FinishTransfer(message->easy_handle, message->data.result, idleHandles, activeHandles);
+                }
+            }
+
+            curl_multi_poll(multi, nullptr, 0, pollMs, nullptr);
+        }
+
+        // Abandon anything that did not finish before the drain deadline
+        while (!activeHandles.empty()) {
+            FinishTransfer(activeHandles.back(), CURLE_ABORTED_BY_CALLBACK, idleHandles, activeHandles);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.failed.fetch_add(asyncQueue.size(), std::memory_order_relaxed);
+        asyncQueue.clear();
+        for (AsyncRequest& request : syncQueue) {
+            request.completion->result = CURLE_ABORTED_BY_CALLBACK;
+            request.completion->done = true;
+            NotifyFinished(*request.completion);
+        }
+        syncQueue.clear();
+
+        for (CURL* easy : idleHandles) {
+            curl_easy_cleanup(easy);
+        }
+        curl_multi_cleanup(multi);
+        multi = nullptr;
+
+        finished = true;
+        workerStopped.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable spaceAvailable;
+    std::condition_variable workerStopped;
+    std::deque<AsyncRequest> syncQueue;
+    std::deque<AsyncRequest> asyncQueue;
+    std::vector<TransferCompletion*> cancelRequests; // Running transfers to stop (hedge losers)
+    size_t activeAsync = 0;
+    Limits currentLimits{};
+    CURLM* multi = nullptr;
+    std::thread worker;
+    bool stopping = false;
+    bool finished = false;
+    std::chrono::steady_clock::time_point drainDeadline{};
+    Counters counters;
+};
+
+#endif // IO_ENGINE_H
@@ -0,0 +1,48 @@
+#ifndef MODULE_PIN_H
+#define MODULE_PIN_H
+
+#include <windows.h>
+#include <mutex>
+
+// Reference on the DLL's own module, held while its background threads may run.
+//
+// DllMain cannot wait for a thread: the thread still runs DLL code after it signals that
+// it is done, and the module is unmapped as soon as DllMain returns. So the first
+// background thread (shared engine, warm-up or capture flush) takes a reference before it
+// is started, and a FreeLibrary without CustomDllShutdown leaves the DLL loaded instead
+// of unmapping code the thread runs. CustomDllShutdown joins the threads and releases the
+// reference. While no thread has been started, FreeLibrary unloads the DLL as before.
+class ModulePin {
+public:
+    // Take the reference, once (before starting a background thread)
+    static void Acquire() {
+        std::lock_guard<std::mutex> lock(Mutex());
+        if (!Module()) {
+            GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&ModulePin::Acquire),
+                               &Module());
+        }
+    }
+
+    // Drop the reference once every background thread has been joined. The caller is an
+    // exported function, so the host's own reference keeps the module mapped while it returns.
+    static void Release() {
+        std::lock_guard<std::mutex> lock(Mutex());
+        if (Module()) {
+            FreeLibrary(Module());
+            Module() = nullptr;
+        }
+    }
+
+private:
+    static std::mutex& Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static HMODULE& Module() {
+        static HMODULE module = nullptr;
+        return module;
+    }
+};
+
+#endif // MODULE_PIN_H
@@ -0,0 +1,148 @@
+#ifndef REQUEST_BUFFER_H
+#define REQUEST_BUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+// Layout of the OpenScape Contact Center key/value buffers:
+// 2 characters with the pair count, then fixed 32-byte keys and 128-byte values,
+// each padded with NULLs.
+constexpr unsigned int HEADER_SIZE = 2;
+constexpr unsigned int KEY_SIZE = 32;
+constexpr unsigned int VALUE_SIZE = 128;
+constexpr unsigned int PAIR_SIZE = KEY_SIZE + VALUE_SIZE;
+
+// View of a fixed-size NULL-padded field, stopping at the first NULL
+inline std::string_view FieldView(const char* field, size_t size) {
+    const void* terminator = memchr(field, '\0', size);
+    return std::string_view(field, terminator ? static_cast<const char*>(terminator) - field : size);
+}
+
+// ASCII case-insensitive comparison
+inline bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        char ca = a[i];
+        char cb = b[i];
+        if (ca >= 'A' && ca <= 'Z') ca = static_cast<char>(ca - 'A' + 'a');
+        if (cb >= 'A' && cb <= 'Z') cb = static_cast<char>(cb - 'A' + 'a');
+        if (ca != cb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the pair count into the 2-character header of an output buffer
+inline void WriteOutputCount(char* dataOut, unsigned int count) {
+    dataOut[0] = static_cast<char>('0' + (count / 10) % 10);
+    dataOut[1] = static_cast<char>('0' + count % 10);
+}
+
+// Key field of output slot index
+inline char* OutputKey(char* dataOut, unsigned int index) {
+    return dataOut + HEADER_SIZE + index * PAIR_SIZE;
+}
+
+// Value field of output slot index
+inline char* OutputValue(char* dataOut, unsigned int index) {
+    return OutputKey(dataOut, index) + KEY_SIZE;
+}
+
+// Write a NULL-padded field, truncating so at least one terminating NULL remains
+inline void WriteField(char* field, size_t size, std::string_view text) {
+    const size_t length = text.size() < size - 1 ? text.size() : size - 1;
+    memcpy(field, text.data(), length);
+    memset(field + length, 0, size - length);
+}
+
+// Write key and value into output slot index
+inline void WriteOutputPair(char* dataOut, unsigned int index, std::string_view key, std::string_view value) {
+    WriteField(OutputKey(dataOut, index), KEY_SIZE, key);
+    WriteField(OutputValue(dataOut, index), VALUE_SIZE, value);
+}
+
+// One key/value pair, viewing directly into the input buffer
+struct Parameter {
+    std::string_view key;
+    std::string_view value;
+};
+
+// Fixed-capacity table of input parameters.
+//
+// The slot layout already bounds every key and value, so the table stores views into
+// dataIn instead of copies and never allocates. After parsing the pairs are sorted by
+// key with duplicates collapsed to the last occurrence, which keeps the iteration
+// order (and therefore the generated URL) identical to the std::map it replaces.
+// dataIn must outlive the table.
+template <unsigned int Capacity>
+class ParameterTable {
+public:
+    // Parse numParameters pairs from dataIn (numParameters must not exceed Capacity)
+    void Parse(const char* dataIn, unsigned int numParameters) {
+        count = 0;
+        for (unsigned int i = 0; i < numParameters && i < Capacity; i++) {
+            const char* pair = dataIn + HEADER_SIZE + i * PAIR_SIZE;
+            Insert({FieldView(pair, KEY_SIZE), FieldView(pair + KEY_SIZE, VALUE_SIZE)});
+        }
+    }
+
+    // Find a parameter by exact key, or nullptr if absent
+    const Parameter* Find(std::string_view key) const {
+        size_t lo = 0;
+        size_t hi = count;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            const int cmp = items[mid].key.compare(key);
+            if (cmp == 0) {
+                return &items[mid];
+            }
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return nullptr;
+    }
+
+    // Find a parameter by ASCII case-insensitive key, or nullptr if absent
+    const Parameter* FindIgnoreCase(std::string_view key) const {
+        for (size_t i = 0; i < count; i++) {
+            if (EqualsIgnoreCase(items[i].key, key)) {
+                return &items[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const Parameter* begin() const { return items; }
+    const Parameter* end() const { return items + count; }
+    size_t size() const { return count; }
+
+private:
+    // Sorted insert; a repeated key replaces the earlier value
+    void Insert(const Parameter& parameter) {
+        size_t pos = count;
+        while (pos > 0 && items[pos - 1].key.compare(parameter.key) > 0) {
+            pos--;
+        }
+        if (pos > 0 && items[pos - 1].key == parameter.key) {
+            items[pos - 1].value = parameter.value;
+            return;
+        }
+        for (size_t i = count; i > pos; i--) {
+            items[i] = items[i - 1];
+        }
+        items[pos] = parameter;
+        count++;
+    }
+
+    Parameter items[Capacity];
+    size_t count = 0;
+};
+
+#endif // REQUEST_BUFFER_H
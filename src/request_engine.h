@@ -0,0 +1,914 @@
+#ifndef REQUEST_ENGINE_H
+#define REQUEST_ENGINE_H
+
+#include <chrono>
+#include <memory>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <curl/curl.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "backend_pool.h"
+#include "capture.h"
+#include "circuit_breaker.h"
+#include "curl_handle_pool.h"
+#include "dll_stats.h"
+#include "io_engine.h"
+#include "request_buffer.h"
+#include "response_cache.h"
+#include "response_stream.h"
+#include "single_flight.h"
+#include "trace.h"
+#include "url_encode.h"
+
+// Error codes
+enum ErrorCode {
+    SUCCESS = 0,
+    FAIL = 1
+};
+
+// Global error message buffer
+inline thread_local char g_lastErrorMessage[512] = {0};
+
+// Function to set the last error message
+inline void SetLastErrorMessage(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(g_lastErrorMessage, sizeof(g_lastErrorMessage), format, args);
+    va_end(args);
+}
+
+// Encoding of POST request bodies
+enum class BodyFormat {
+    Form, // application/x-www-form-urlencoded, like the GET query string
+    Json  // A flat JSON object of string values
+};
+
+// How the CFResp value is taken from the response body
+enum class ResponseExtract {
+    Body,   // Buffer the whole body and return its start
+    Prefix, // Keep only the start of the body as it streams in
+    Json,   // Keep only one JSON field's value as it streams in
+    Map     // Fill one output pair per [response_map] entry as the body streams in
+};
+
+// Cached responses for idempotent endpoints
+inline ResponseCache g_responseCache;
+
+// In-flight calls that identical concurrent requests can join
+inline SingleFlight g_singleFlight;
+
+// Call counters and latency histograms reported by GetDllStats
+inline DllMetrics g_metrics;
+
+// Fail-fast state for a failing backend, and the timeout that follows its latency
+inline CircuitBreaker g_circuitBreaker;
+inline AdaptiveTimeout g_adaptiveTimeout;
+
+// Load and health of the backend nodes listed in base_urls
+inline BackendPool g_backendPool;
+
+// Output of sampled call spans ([trace] section)
+inline Tracer g_tracer;
+
+// Milliseconds on the monotonic clock
+inline long long SteadyMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Callback function for curl to write response data
+inline size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp)
+{
+    const size_t totalSize = size * nmemb;
+    userp->append(static_cast<char*>(contents), totalSize);
+    return totalSize;
+}
+
+// Append the URL-encoded form of value to out
+inline void AppendUrlEncoded(std::string& out, std::string_view value) {
+    UrlEncode::Append(out, value);
+}
+
+// Key sent for a parameter: an "Endpoint" key is sent as "endpoint" when LowercaseEndpoint is set
+template <bool LowercaseEndpoint>
+std::string_view FormKey(const Parameter& parameter) {
+    if (LowercaseEndpoint && EqualsIgnoreCase(parameter.key, "endpoint")) {
+        return "endpoint";
+    }
+    return parameter.key;
+}
+
+// Append the parameters form-encoded as key=value pairs joined by '&' (CFResp is not sent).
+// Keys and values are both encoded. The exact length is computed first, so out grows
+// once and the pairs are encoded straight into it.
+template <bool LowercaseEndpoint = false, unsigned int Capacity>
+void AppendFormParameters(std::string& out, const ParameterTable<Capacity>& parameters) {
+    // First pass: the encoded length of every pair plus its '=' and '&'
+    size_t length = 0;
+    for (const Parameter& parameter : parameters) {
+        // Skip CFResp parameter in URL
+        if (parameter.key == "CFResp") {
+            continue;
+        }
+        length += (length > 0) + UrlEncode::EncodedLength(FormKey<LowercaseEndpoint>(parameter)) + 1 +
+                  UrlEncode::EncodedLength(parameter.value);
+    }
+
+    // Second pass: encode in place
+    const size_t start = out.size();
+    out.resize(start + length);
+    char* position = &out[0] + start;
+    bool firstParam = true;
+    for (const Parameter& parameter : parameters) {
+        if (parameter.key == "CFResp") {
+            continue;
+        }
+
+        if (!firstParam) {
+            *position++ = '&';
+        }
+
+        position = UrlEncode::EncodeTo(position, FormKey<LowercaseEndpoint>(parameter));
+        *position++ = '=';
+        position = UrlEncode::EncodeTo(position, parameter.value);
+        firstParam = false;
+    }
+}
+
+// Build the GET URL for the request parameters into url (CFResp is not sent).
+// urlPrefix is the base URL with its '?', kept with the configuration.
+template <bool LowercaseEndpoint = false, unsigned int Capacity>
+void BuildRequestUrl(std::string& url, std::string_view urlPrefix, const ParameterTable<Capacity>& parameters) {
+    url.assign(urlPrefix);
+    AppendFormParameters<LowercaseEndpoint>(url, parameters);
+}
+
+// Append text as a quoted JSON string. Input fields are ISO-8859-1, so bytes above
+// 0x7F are re-encoded as their two-byte UTF-8 form.
+inline void AppendJsonString(std::string& out, std::string_view text) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out += '"';
+    for (const char c : text) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (byte == '"' || byte == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20) {
+            out.append("\\u00");
+            out += hexDigits[byte >> 4];
+            out += hexDigits[byte & 0xF];
+        } else if (byte >= 0x80) {
+            out += static_cast<char>(0xC0 | (byte >> 6));
+            out += static_cast<char>(0x80 | (byte & 0x3F));
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Append the parameters as a flat JSON object of strings (CFResp is not sent)
+template <unsigned int Capacity>
+void AppendJsonParameters(std::string& out, const ParameterTable<Capacity>& parameters) {
+    out += '{';
+    bool firstParam = true;
+    for (const Parameter& parameter : parameters) {
+        if (parameter.key == "CFResp") {
+            continue;
+        }
+        if (!firstParam) {
+            out += ',';
+        }
+        AppendJsonString(out, parameter.key);
+        out += ':';
+        AppendJsonString(out, parameter.value);
+        firstParam = false;
+    }
+    out += '}';
+}
+
+#ifdef HAVE_ZLIB
+// Gzip data into out with this thread's deflate state, which is allocated once and
+// reset between bodies. Returns false if zlib fails.
+inline bool GzipCompress(std::string_view data, std::string& out) {
+    struct DeflateState {
+        z_stream stream = {};
+        bool ready = false;
+        ~DeflateState() {
+            if (ready) {
+                deflateEnd(&stream);
+            }
+        }
+    };
+    thread_local DeflateState state;
+
+    // Fastest level: the point is a smaller upload, not the best ratio
+    if (!state.ready) {
+        if (deflateInit2(&state.stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        state.ready = true;
+    } else if (deflateReset(&state.stream) != Z_OK) {
+        return false;
+    }
+
+    out.resize(deflateBound(&state.stream, static_cast<uLong>(data.size())));
+    state.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    state.stream.avail_in = static_cast<uInt>(data.size());
+    state.stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    state.stream.avail_out = static_cast<uInt>(out.size());
+    const int status = deflate(&state.stream, Z_FINISH);
+    out.resize(state.stream.total_out);
+    return status == Z_STREAM_END;
+}
+#endif
+
+// A parsed request that still has to be sent
+struct PreparedRequest {
+    std::string url;
+    RequestBody body;
+    std::string postKey; // URL and uncompressed body of a POST request, for caching and coalescing
+    bool shouldReturnResponse = false;
+    long cacheTtl = 0; // Seconds to keep the response (0 = not cacheable)
+    ResponseExtractor extractor; // Receives the body when the response is streamed
+
+    // What identifies identical requests: the URL, plus the body for POST
+    const std::string& Key() const { return body.post ? postKey : url; }
+};
+
+// The request path of CustomDLL and CustomDLLStatic.
+//
+// Both DLLs are built from this template; they differ only in their Config type, which
+// supplies the settings and a few compile-time switches:
+//
+//   static constexpr unsigned int MAX_PARAMETERS  Input pairs accepted in one request
+//   static constexpr bool RUNTIME_FEATURES        POST, cache, async, coalescing, shared
+//                                                 engine, streaming, batch, multiple
+//                                                 backend node, tracing and capture support
+//   static constexpr bool CFRESP_ACCEPTS_ONE      CFResp=1 counts as CFResp=yes
+//   static constexpr bool LOWERCASE_ENDPOINT      An "Endpoint" key is sent as "endpoint"
+//   static constexpr bool FAIL_ONLY_WITH_CFRESP   Failures of calls without CFResp=yes
+//                                                 still return 0
+//   static Current()                              The settings for this call
+//   baseUrl, urlPrefix (baseUrl and '?'), maxIdleConnections, idleTimeout and
+//   GetTransferOptions()
+//
+// CustomDLL uses ConfigSettings, a snapshot of config.ini, with every feature and all of
+// its settings. CustomDLLStatic uses a constexpr StaticConfig whose settings are static
+// constants, so the URL prefix, timeouts and SSL options fold into the code and the
+// feature branches are discarded at compile time.
+template <typename Config>
+class RequestEngine {
+public:
+    using Parameters = ParameterTable<Config::MAX_PARAMETERS>;
+
+    // Body of the single-request export (CustomFunctionExample, ProcessContactCenterRequest)
+    static long Handle(const char* dataIn, char* dataOut)
+    {
+        try {
+            // Get the configuration for this call
+            const Config& config = Config::Current();
+
+            // Time the phases of sampled calls
+            std::optional<CallTrace> trace;
+            if constexpr (Config::RUNTIME_FEATURES) {
+                Capture(config, dataIn, 0);
+                if (config.traceEnabled && Tracer::Sample(config.traceSampleEvery)) {
+                    trace.emplace();
+                }
+            }
+
+            // Parse the input and build the URL and body
+            // The buffers are reused by this thread, so they only grow on the widest requests
+            thread_local PreparedRequest prepared;
+            long result = SUCCESS;
+            if (Prepare(dataIn, dataOut, config, prepared, result, trace ? &*trace : nullptr)) {
+                if constexpr (Config::RUNTIME_FEATURES) {
+                    result = HandleConfigured(config, prepared, dataOut, trace ? &*trace : nullptr);
+                } else {
+                    // Initialize response string with reasonable capacity
+                    std::string responseData;
+                    responseData.reserve(1024);
+                    long httpCode = 0;
+                    const CURLcode res = PerformPooled(config, prepared.url, prepared.body,
+                                                       config.GetTransferOptions(), BodySink(), responseData,
+                                                       httpCode);
+                    result = Complete(prepared, dataOut, config, res, httpCode, responseData);
+                }
+            }
+
+            if constexpr (Config::RUNTIME_FEATURES) {
+                if (trace) {
+                    g_tracer.Emit(trace->Finish(result), config.GetTraceSettings());
+                }
+            }
+            return result;
+        }
+        catch (const std::exception& e) {
+            // Catch standard exceptions
+            SetLastErrorMessage("Unexpected exception: %s", e.what());
+            return FAIL;
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            SetLastErrorMessage("Unknown exception occurred");
+            return FAIL;
+        }
+    }
+
+    // Body of CustomFunctionBatch: results[i] receives each request's return code
+    static long HandleBatch(const char** dataIn, char** dataOut, long* results, size_t count)
+    {
+        static_assert(Config::RUNTIME_FEATURES, "Batches are sent over the shared engine");
+        try {
+            // Ensure the arrays are not null
+            if (count > 0 && (!dataIn || !results)) {
+                SetLastErrorMessage("Invalid input: dataIn or results is null");
+                return FAIL;
+            }
+
+            // Get the cached configuration snapshot
+            const Config& config = Config::Current();
+
+            // Parse every request; those answered without a transfer get their result now
+            std::vector<PreparedRequest> prepared(count);
+            std::vector<size_t> pending;
+            std::vector<CircuitBreaker::Permit> permits;
+            std::vector<BackendNode*> nodes;
+            std::vector<IoEngine::BatchTransfer> transfers;
+            const TransferOptions options = GetTransferOptions(config);
+            const bool streaming = config.StreamsResponse();
+            for (size_t i = 0; i < count; i++) {
+                char* out = dataOut ? dataOut[i] : nullptr;
+                results[i] = SUCCESS;
+                Capture(config, dataIn[i], CAPTURE_RECORD_BATCH);
+                if (Prepare(dataIn[i], out, config, prepared[i], results[i])) {
+                    // Requests the circuit breaker turns away fail without a transfer
+                    const CircuitBreaker::Permit permit = AcquirePermit(config);
+                    if (permit == CircuitBreaker::Permit::Rejected) {
+                        results[i] = FAIL;
+                        continue;
+                    }
+                    pending.push_back(i);
+                    permits.push_back(permit);
+                    BackendNode* node = nodes.emplace_back(BeginBackend(config));
+                    IoEngine::BatchTransfer& transfer = transfers.emplace_back();
+                    transfer.url = NodeUrl(config, prepared[i], node);
+                    transfer.body = prepared[i].body;
+                    transfer.options = options;
+                    if (streaming) {
+                        transfer.sink = StartExtraction(prepared[i], config);
+                    } else {
+                        transfer.responseData.reserve(1024);
+                    }
+                }
+            }
+
+            // Send the rest together over the shared engine's connections
+            IoEngine::Instance().PerformBatch(transfers, config.GetEngineLimits(),
+                                              static_cast<size_t>(config.batchMaxConcurrency));
+
+            for (size_t k = 0; k < pending.size(); k++) {
+                const size_t i = pending[k];
+                IoEngine::BatchTransfer& transfer = transfers[k];
+                if (streaming) {
+                    transfer.result = FinishExtraction(prepared[i].extractor, config, transfer.result,
+                                                       transfer.responseData);
+                }
+                g_metrics.RecordTransfer(transfer.result, transfer.httpCode, transfer.timings);
+                RecordOutcome(config, permits[k], options, transfer.result, transfer.httpCode, transfer.timings);
+                FinishBackend(config, nodes[k], transfer.result, transfer.httpCode, transfer.timings);
+                results[i] = Complete(prepared[i], dataOut ? dataOut[i] : nullptr, config,
+                                      transfer.result, transfer.httpCode, transfer.responseData);
+            }
+
+            // Report how many failed, keeping the first failure's message
+            size_t failed = 0;
+            for (size_t i = 0; i < count; i++) {
+                g_metrics.RecordCall(results[i] == SUCCESS);
+                if (results[i] != SUCCESS) {
+                    failed++;
+                }
+            }
+            if (failed > 0) {
+                SetLastErrorMessage("%zu of %zu batch requests failed (last error: %s)", failed, count,
+                                    std::string(g_lastErrorMessage).c_str());
+                return FAIL;
+            }
+            return SUCCESS;
+        }
+        catch (const std::exception& e) {
+            // Catch standard exceptions
+            SetLastErrorMessage("Unexpected exception: %s", e.what());
+            return FAIL;
+        }
+        catch (...) {
+            // Catch any other unexpected exceptions
+            SetLastErrorMessage("Unknown exception occurred");
+            return FAIL;
+        }
+    }
+
+private:
+    // Append the raw request buffer to the capture file ([capture] section)
+    static void Capture(const Config& config, const char* dataIn, unsigned int flags) {
+        if (config.captureEnabled && dataIn) {
+            Capturer::Instance().Record(dataIn, CapturedSize(dataIn, Config::MAX_PARAMETERS), flags,
+                                        config.GetCaptureSettings());
+        }
+    }
+
+    // Build the POST body for the request parameters into body, gzipped when it reaches
+    // gzip_min_bytes. The body's buffer is reused, so it only grows on the widest requests.
+    // key, when given, receives the uncompressed body so identical requests can be matched.
+    static void BuildRequestBody(RequestBody& body, std::string* key, const Config& config,
+                                 const Parameters& parameters) {
+        body.post = true;
+        body.headers = config.postHeaders.get();
+        body.data.clear();
+        if (config.postFormat == BodyFormat::Json) {
+            AppendJsonParameters(body.data, parameters);
+        } else {
+            AppendFormParameters(body.data, parameters);
+        }
+
+        if (key) {
+            key->append(body.data);
+        }
+
+#ifdef HAVE_ZLIB
+        // Compress into a second reused buffer and swap it in
+        if (config.gzipMinBytes > 0 && body.data.size() >= static_cast<size_t>(config.gzipMinBytes)) {
+            thread_local std::string compressed;
+            if (GzipCompress(body.data, compressed)) {
+                body.data.swap(compressed);
+                body.headers = config.gzipPostHeaders.get();
+            }
+        }
+#endif
+    }
+
+    // Parse dataIn and build its request URL into prepared. Invalid input and calls that
+    // need no transfer of their own (a cache hit or a fire-and-forget submission) are
+    // answered here: the function returns false with result set. Returns true when the
+    // request still has to be sent. trace, when given, receives the parse and build times.
+    static bool Prepare(const char* dataIn, char* dataOut, const Config& config,
+                        PreparedRequest& prepared, long& result, CallTrace* trace = nullptr)
+    {
+        // Ensure dataIn is not null
+        if (!dataIn) {
+            SetLastErrorMessage("Invalid input: dataIn is null");
+            result = FAIL;
+            return false;
+        }
+
+        // Determine number of input parameters
+        char numParametersAsString[3] = {dataIn[0], dataIn[1], '\0'};
+        const unsigned int numParameters = atoi(numParametersAsString);
+
+        // Validate number of parameters
+        if (numParameters > Config::MAX_PARAMETERS) { // Arbitrary limit for safety
+            SetLastErrorMessage("Too many parameters: %d (maximum is %d)", numParameters, Config::MAX_PARAMETERS);
+            result = FAIL;
+            return false;
+        }
+
+        // Flat table of key/value views straight into dataIn (no copies)
+        Parameters parameters;
+        parameters.Parse(dataIn, numParameters);
+        if (trace) {
+            trace->Parsed();
+        }
+
+        // Check if CFResp is set to yes
+        const Parameter* cfResp = parameters.Find("CFResp");
+        prepared.shouldReturnResponse = cfResp &&
+            (cfResp->value == "yes" || (Config::CFRESP_ACCEPTS_ONE && cfResp->value == "1"));
+
+        // Put the parameters in the GET query string, or in the body for POST
+        prepared.body.post = false;
+        prepared.body.headers = nullptr;
+        if constexpr (Config::RUNTIME_FEATURES) {
+            if (config.postRequests) {
+                prepared.url.assign(config.baseUrl);
+                const bool needsKey = config.cacheEnabled || config.coalesceRequests;
+                if (needsKey) {
+                    prepared.postKey.assign(prepared.url);
+                    prepared.postKey += '\n';
+                }
+                BuildRequestBody(prepared.body, needsKey ? &prepared.postKey : nullptr, config, parameters);
+            }
+        }
+        if (!prepared.body.post) {
+            BuildRequestUrl<Config::LOWERCASE_ENDPOINT>(prepared.url, config.urlPrefix, parameters);
+        }
+        if (trace) {
+            trace->Built();
+        }
+
+        if constexpr (Config::RUNTIME_FEATURES) {
+            // Serve repeated lookups for cacheable endpoints without a round trip
+            prepared.cacheTtl = prepared.shouldReturnResponse && dataOut && config.cacheEnabled
+                ? config.CacheTtlFor(parameters.FindIgnoreCase("endpoint")) : 0;
+            if (prepared.cacheTtl > 0) {
+                // A mapped entry holds the whole packed output, a CFResp entry only the value
+                if (config.MapsResponse()) {
+                    if (g_responseCache.Lookup(prepared.Key(), dataOut, config.MappedOutputSize())) {
+                        result = SUCCESS;
+                        return false;
+                    }
+                } else if (g_responseCache.Lookup(prepared.Key(), OutputValue(dataOut, 0), VALUE_SIZE)) {
+                    WriteOutputCount(dataOut, 1);
+                    WriteField(OutputKey(dataOut, 0), KEY_SIZE, "CFResp");
+                    result = SUCCESS;
+                    return false;
+                }
+            }
+
+            // Nobody reads the response without CFResp=yes, so hand it to the background worker
+            if (config.asyncMode && !prepared.shouldReturnResponse) {
+                // Nobody waits for the outcome, so the node is chosen without tracking the request
+                BackendNode* node = config.backends.empty() ? nullptr
+                    : g_backendPool.Pick(config.backends, SteadyMillis(), config.GetBackendSettings());
+                IoEngine::SubmitResult submitted = IoEngine::Instance().Submit(
+                    {NodeUrl(config, prepared, node), config.GetTransferOptions(), nullptr, prepared.body},
+                    config.asyncOverflow, config.GetEngineLimits());
+
+                if (submitted == IoEngine::SubmitResult::Rejected) {
+                    SetLastErrorMessage("Async queue full: request rejected (%ld queued)", config.asyncQueueSize);
+                    result = FAIL;
+                    return false;
+                }
+                result = SUCCESS;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Send a request to url on this thread's pooled handle, into sink when it is set
+    // and into body otherwise
+    static CURLcode PerformPooled(const Config& config, const std::string& url, const RequestBody& requestBody,
+                                  const TransferOptions& options, const BodySink& sink, std::string& body,
+                                  long& httpCode, TransferTimings* timings = nullptr)
+    {
+        // Get this thread's pooled curl handle (keeps warm connections between calls)
+        CURL* curl = CurlHandlePool::Acquire(PoolLimits(config));
+        if (!curl) {
+            return CURLE_FAILED_INIT;
+        }
+
+        // Set URL, timeouts, connection and SSL options from configuration
+        ApplyTransferOptions(curl, url.c_str(), options);
+        ApplyRequestBody(curl, requestBody);
+
+        // Set write callback function (straight into the extractor when streaming)
+        if (sink.write) {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sink.write);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, sink.userdata);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        }
+
+        // Perform the request
+        const CURLcode result = curl_easy_perform(curl);
+
+        // Get HTTP response code and the timing breakdown
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+        if (timings) {
+            *timings = ReadTransferTimings(curl);
+        }
+        return result;
+    }
+
+    // Send a prepared request with the configured transport, streaming and coalescing
+    // and write its response to dataOut
+    static long HandleConfigured(const Config& config, PreparedRequest& prepared, char* dataOut,
+                                 CallTrace* trace = nullptr)
+    {
+        // Fail fast while the backend is known to be failing
+        const CircuitBreaker::Permit permit = AcquirePermit(config);
+        if (permit == CircuitBreaker::Permit::Rejected) {
+            return FAIL;
+        }
+        const TransferOptions options = GetTransferOptions(config);
+        if (trace && !config.traceHeader.empty()) {
+            AttachTraceHeader(config, prepared, *trace);
+        }
+
+        // Initialize response string with reasonable capacity (a streamed response only holds the value)
+        const bool streaming = config.StreamsResponse();
+        std::string responseData;
+        if (!streaming) {
+            responseData.reserve(1024);
+        }
+
+        // Send the request on the shared engine or this thread's pooled handle
+        // (only runs on this thread when the call is not coalesced into another one)
+        TransferTimings timings;
+        bool sent = false;
+        auto fetch = [&](std::string& body, long& httpCode) -> CURLcode {
+            sent = true;
+
+            // A slow GET with a buffered response can be hedged to a second node
+            if (config.hedgeRequests && config.backends.size() > 1 && !prepared.body.post && !streaming) {
+                return PerformHedged(config, prepared, options, body, httpCode, timings);
+            }
+
+            BackendNode* node = BeginBackend(config);
+            const std::string& url = NodeUrl(config, prepared, node);
+            const BodySink sink = streaming ? StartExtraction(prepared, config) : BodySink();
+            CURLcode result;
+            if (config.sharedEngine) {
+                // Submit to the shared curl_multi engine and wait for completion
+                result = IoEngine::Instance().Perform(url, prepared.body, options, config.GetEngineLimits(), body,
+                                                      httpCode, &timings, streaming ? &sink : nullptr);
+            } else {
+                result = PerformPooled(config, url, prepared.body, options, sink, body, httpCode, &timings);
+            }
+            FinishBackend(config, node, result, httpCode, timings);
+            return streaming ? FinishExtraction(prepared.extractor, config, result, body) : result;
+        };
+
+        long httpCode = 0;
+        CURLcode res = config.coalesceRequests
+            ? g_singleFlight.Do(prepared.Key(), responseData, httpCode, fetch)  // Share identical in-flight calls
+            : fetch(responseData, httpCode);
+        if (sent) {
+            g_metrics.RecordTransfer(res, httpCode, timings);
+            RecordOutcome(config, permit, options, res, httpCode, timings);
+        } else {
+            g_circuitBreaker.Release(permit);
+        }
+        if (trace) {
+            trace->Transferred(sent, prepared.body.post, res, httpCode, timings);
+        }
+
+        return Complete(prepared, dataOut, config, res, httpCode, responseData);
+    }
+
+    // Send the trace header with a traced request, after the body headers of a POST.
+    // The list is rebuilt by this thread's next traced call, once this one is done with it.
+    static void AttachTraceHeader(const Config& config, PreparedRequest& prepared, CallTrace& trace) {
+        thread_local std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> headers(nullptr,
+                                                                                        curl_slist_free_all);
+        curl_slist* list = nullptr;
+        for (const curl_slist* header = prepared.body.headers; header; header = header->next) {
+            list = curl_slist_append(list, header->data);
+        }
+        list = curl_slist_append(list, trace.Header(config.traceHeader));
+        headers.reset(list);
+        prepared.body.headers = list;
+    }
+
+    // Idle connections kept by this thread's pooled handle: max_idle_connections for each
+    // backend node, so every node keeps warm connections
+    static CurlHandlePool::Limits PoolLimits(const Config& config) {
+        long connections = config.maxIdleConnections;
+        if constexpr (Config::RUNTIME_FEATURES) {
+            if (!config.backends.empty()) {
+                connections *= static_cast<long>(config.backends.size());
+            }
+        }
+        return {connections, config.idleTimeout};
+    }
+
+    // The request's URL on node: prepared.url starts with config.baseUrl, the first node's
+    // base URL, so caching and coalescing see the same key whichever node serves it
+    static const std::string& NodeUrl(const Config& config, const PreparedRequest& prepared,
+                                      const BackendNode* node) {
+        if (!node || node->baseUrl == config.baseUrl) {
+            return prepared.url;
+        }
+        thread_local std::string url;
+        url.assign(node->baseUrl);
+        url.append(prepared.url, config.baseUrl.size(), std::string::npos);
+        return url;
+    }
+
+    // Pick the node for a request and count it as in flight (nullptr with a single base_url)
+    static BackendNode* BeginBackend(const Config& config) {
+        if (config.backends.empty()) {
+            return nullptr;
+        }
+        BackendNode* node = g_backendPool.Pick(config.backends, SteadyMillis(), config.GetBackendSettings());
+        BackendPool::Begin(node);
+        return node;
+    }
+
+    // Feed a transfer's outcome to its node's load and health
+    static void FinishBackend(const Config& config, BackendNode* node, CURLcode result, long httpCode,
+                              const TransferTimings& timings) {
+        if (node) {
+            g_backendPool.Finish(node, result, httpCode, timings, SteadyMillis(), config.GetBackendSettings());
+        }
+    }
+
+    // Send a GET over the shared engine, and a second copy to another node when the first
+    // has not answered within the hedge delay; the first success is used
+    static CURLcode PerformHedged(const Config& config, const PreparedRequest& prepared,
+                                  const TransferOptions& options, std::string& body, long& httpCode,
+                                  TransferTimings& timings) {
+        const long long now = SteadyMillis();
+        const BackendPool::Settings settings = config.GetBackendSettings();
+        BackendNode* nodes[2] = {g_backendPool.Pick(config.backends, now, settings), nullptr};
+        nodes[1] = g_backendPool.PickHedge(config.backends, now, settings, nodes[0]);
+
+        // A fixed delay, or the recent p95 (no hedging until there are enough samples)
+        const long delayMs = config.hedgeDelayMs > 0 ? config.hedgeDelayMs : g_backendPool.P95Ms(now);
+
+        IoEngine::HedgeCopy copies[2];
+        size_t winner = 0;
+        const bool hedging = nodes[1] && delayMs > 0;
+        BackendPool::Begin(nodes[0]);
+        if (hedging) {
+            // Count the hedge node as busy for the whole call, so concurrent hedges spread out
+            BackendPool::Begin(nodes[1]);
+            const std::string url = NodeUrl(config, prepared, nodes[0]);
+            winner = IoEngine::Instance().PerformHedged(url, NodeUrl(config, prepared, nodes[1]), prepared.body,
+                                                        options, std::chrono::milliseconds(delayMs),
+                                                        config.GetEngineLimits(), copies);
+        } else {
+            copies[0].sent = true;
+            copies[0].result = IoEngine::Instance().Perform(NodeUrl(config, prepared, nodes[0]), prepared.body,
+                                                            options, config.GetEngineLimits(),
+                                                            copies[0].responseData, copies[0].httpCode,
+                                                            &copies[0].timings);
+        }
+
+        for (size_t i = 0; i < (hedging ? 2 : 1); i++) {
+            if (!copies[i].sent || copies[i].cancelled) {
+                BackendPool::Cancel(nodes[i]);
+            } else {
+                g_backendPool.Finish(nodes[i], copies[i].result, copies[i].httpCode, copies[i].timings,
+                                     SteadyMillis(), settings);
+            }
+        }
+
+        body.swap(copies[winner].responseData);
+        httpCode = copies[winner].httpCode;
+        timings = copies[winner].timings;
+        return copies[winner].result;
+    }
+
+    // Ask the circuit breaker whether a call may go to the backend; a rejected call gets
+    // its error message here
+    static CircuitBreaker::Permit AcquirePermit(const Config& config) {
+        if (!config.circuitBreaker) {
+            return CircuitBreaker::Permit::Allowed;
+        }
+        const long long now = SteadyMillis();
+        const CircuitBreaker::Permit permit = g_circuitBreaker.Acquire(now, config.GetBreakerSettings());
+        if (permit == CircuitBreaker::Permit::Rejected) {
+            SetLastErrorMessage("Circuit breaker open: backend failed %ld times in a row (next probe in %lld ms)",
+                                g_circuitBreaker.ConsecutiveFailures(), g_circuitBreaker.RetryInMs(now));
+        }
+        return permit;
+    }
+
+    // Options for the next transfer, with the adaptive timeout when it is enabled
+    static TransferOptions GetTransferOptions(const Config& config) {
+        TransferOptions options = config.GetTransferOptions();
+        if (config.adaptiveTimeout) {
+            options.timeoutMs = g_adaptiveTimeout.CurrentMs(SteadyMillis(), config.GetAdaptiveTimeoutSettings());
+        }
+        return options;
+    }
+
+    // Feed a transfer's outcome to the circuit breaker and the adaptive timeout
+    static void RecordOutcome(const Config& config, CircuitBreaker::Permit permit, const TransferOptions& options,
+                              CURLcode result, long httpCode, const TransferTimings& timings) {
+        if (config.circuitBreaker) {
+            g_circuitBreaker.Record(permit, result, httpCode, SteadyMillis(), config.GetBreakerSettings());
+        }
+        if (config.adaptiveTimeout) {
+            // A timed-out transfer counts as the full timeout, so a timeout that is too tight loosens again
+            if (result == CURLE_OPERATION_TIMEDOUT) {
+                g_adaptiveTimeout.Record(static_cast<long long>(options.timeoutMs > 0 ? options.timeoutMs
+                                                                                    : options.timeout * 1000) * 1000);
+            } else if (result == CURLE_OK && timings.valid) {
+                g_adaptiveTimeout.Record(timings.total);
+            }
+        }
+    }
+
+    // Point a prepared request's extractor at a new response and return the sink that feeds it
+    static BodySink StartExtraction(PreparedRequest& prepared, const Config& config) {
+        const size_t drain = static_cast<size_t>(config.responseDrainBytes);
+        if (config.MapsResponse()) {
+            prepared.extractor.Reset(config.responseMapFormat, config.responseMapFields.data(),
+                                     config.responseMapFields.size(), drain);
+        } else if (config.responseExtract == ResponseExtract::Json && !config.responseJsonField.empty()) {
+            prepared.extractor.Reset(ResponseExtractor::Format::Json, &config.responseJsonField, 1, drain);
+        } else {
+            prepared.extractor.Reset(ResponseExtractor::Format::Prefix, nullptr, 0, drain);
+        }
+        return {ResponseExtractor::WriteCallback, &prepared.extractor};
+    }
+
+    // Pack the mapped values into out in the output buffer layout, one pair per configured
+    // key in [response_map] order (empty values for fields the response did not have)
+    static void PackMappedOutput(std::string& out, const Config& config, const ResponseExtractor& extractor) {
+        const unsigned int pairs = static_cast<unsigned int>(config.responseMapKeys.size());
+        out.assign(config.MappedOutputSize(), '\0');
+        WriteOutputCount(out.data(), pairs);
+        for (unsigned int i = 0; i < pairs; i++) {
+            const std::string_view value = extractor.Value(i);
+
+            // Count values cut to fit the 127-character output value
+            if (value.size() > VALUE_SIZE - 1) {
+                g_metrics.RecordTruncated();
+            }
+            WriteOutputPair(out.data(), i, config.responseMapKeys[i], value);
+        }
+    }
+
+    // Turn a streamed transfer's outcome into a result and body: an abort the extractor asked
+    // for is not an error, and the extracted value (or the packed mapped output) stands in
+    // for the body, so coalesced callers and the cache see it too
+    static CURLcode FinishExtraction(const ResponseExtractor& extractor, const Config& config, CURLcode result,
+                                     std::string& body) {
+        if (config.MapsResponse()) {
+            PackMappedOutput(body, config, extractor);
+        } else {
+            body.assign(extractor.Value());
+        }
+        return result == CURLE_WRITE_ERROR && extractor.StoppedEarly() ? CURLE_OK : result;
+    }
+
+    // Check the outcome of a prepared request's transfer and write its response to dataOut
+    static long Complete(const PreparedRequest& prepared, char* dataOut, const Config& config,
+                         CURLcode res, long httpCode, const std::string& responseData)
+    {
+        // Without CFResp=yes nobody reads the response, so some builds do not report its failure
+        const long failure = !Config::FAIL_ONLY_WITH_CFRESP || prepared.shouldReturnResponse ? FAIL : SUCCESS;
+
+        // Check for errors
+        if (res != CURLE_OK) {
+            SetLastErrorMessage("Curl request failed: %s", curl_easy_strerror(res));
+            return failure;
+        }
+
+        // Check if HTTP response is successful (200-299)
+        if (httpCode < 200 || httpCode >= 300) {
+            SetLastErrorMessage("HTTP error: received status code %ld", httpCode);
+            return failure;
+        }
+
+        // The response as a C string (stops at the first NULL, like the output value)
+        const std::string_view response = FieldView(responseData.data(), responseData.size());
+
+        if constexpr (Config::RUNTIME_FEATURES) {
+            const size_t cacheMaxBytes = static_cast<size_t>(config.cacheMaxMemoryKb) * 1024;
+
+            // A mapped response is already packed in the output layout; mapping replaces CFResp
+            if (config.MapsResponse()) {
+                if (prepared.cacheTtl > 0) {
+                    g_responseCache.Store(prepared.Key(), responseData, prepared.cacheTtl, cacheMaxBytes);
+                }
+                if (prepared.shouldReturnResponse && dataOut) {
+                    memcpy(dataOut, responseData.data(), responseData.size());
+                }
+                return SUCCESS;
+            }
+
+            // Remember the answer for repeated lookups
+            if (prepared.cacheTtl > 0) {
+                g_responseCache.Store(prepared.Key(), response.substr(0, VALUE_SIZE - 1), prepared.cacheTtl,
+                                      cacheMaxBytes);
+            }
+        }
+
+        // If CFResp=yes was in the input, return the response
+        if (prepared.shouldReturnResponse && dataOut) {
+            // Count responses cut to fit the 127-character output value
+            if constexpr (Config::RUNTIME_FEATURES) {
+                if (response.size() > VALUE_SIZE - 1) {
+                    g_metrics.RecordTruncated();
+                }
+            }
+
+            // Set number of output parameters to 1
+            WriteOutputCount(dataOut, 1);
+
+            // Set key to "CFResp" and copy response data to output value (truncate if too long)
+            WriteOutputPair(dataOut, 0, "CFResp", response);
+        }
+
+        return SUCCESS; // Success
+    }
+};
+
+#endif // REQUEST_ENGINE_H
@@ -0,0 +1,138 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// In-process cache of backend responses keyed on the request URL.
+//
+// The URL is canonical (parameters are emitted in sorted key order), so identical
+// requests map to the same entry. Entries hold output bytes ready to copy into the
+// caller's buffer (the CFResp value, or the packed pairs of a mapped response), which
+// bounds every entry. The cache is split into shards, each with its own mutex and LRU
+// list, so concurrent routing threads rarely contend. maxBytes is divided evenly
+// between the shards.
+class ResponseCache {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Counters {
+        std::atomic<unsigned long long> hits{0};
+        std::atomic<unsigned long long> misses{0};
+        std::atomic<unsigned long long> evictions{0};
+    };
+
+    // Copy a fresh cached response for url into out, NULL-padded to outSize bytes.
+    // Returns false on a miss or an expired entry.
+    bool Lookup(const std::string& url, char* out, size_t outSize) {
+        Shard& shard = ShardFor(url);
+        const Clock::time_point now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto found = shard.index.find(url);
+            if (found != shard.index.end()) {
+                Entry& entry = *found->second;
+                if (entry.expires > now) {
+                    const size_t length = std::min(entry.value.size(), outSize);
+                    memcpy(out, entry.value.data(), length);
+                    memset(out + length, 0, outSize - length);
+                    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+                    counters.hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                Erase(shard, found->second);
+            }
+        }
+        counters.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Store output bytes for ttlSeconds
+    void Store(const std::string& url, std::string_view output, long ttlSeconds, size_t maxBytes) {
+        if (ttlSeconds <= 0 || maxBytes == 0) {
+            return;
+        }
+
+        Shard& shard = ShardFor(url);
+        const size_t shardLimit = maxBytes / SHARD_COUNT;
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.index.find(url);
+        if (found != shard.index.end()) {
+            Erase(shard, found->second);
+        }
+
+        shard.lru.emplace_front();
+        Entry& entry = shard.lru.front();
+        entry.url = url;
+        entry.value.assign(output);
+        entry.expires = Clock::now() + std::chrono::seconds(ttlSeconds);
+        shard.index.emplace(entry.url, shard.lru.begin());
+        shard.bytes += EntrySize(entry);
+
+        // Evict least recently used entries until the shard fits its share of the cap
+        while (shard.bytes > shardLimit && !shard.lru.empty()) {
+            Erase(shard, std::prev(shard.lru.end()));
+            counters.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Number of entries and approximate bytes held across all shards
+    void GetUsage(unsigned long long& entries, unsigned long long& bytes) {
+        entries = 0;
+        bytes = 0;
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            entries += shard.index.size();
+            bytes += shard.bytes;
+        }
+    }
+
+    const Counters& GetCounters() const { return counters; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string url;
+        std::string value;
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru; // Most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    // Approximate footprint of one entry including its list and index nodes
+    static size_t EntrySize(const Entry& entry) {
+        return sizeof(Entry) + 2 * entry.url.capacity() + entry.value.capacity() + 64;
+    }
+
+    Shard& ShardFor(const std::string& url) {
+        return shards[std::hash<std::string>()(url) % SHARD_COUNT];
+    }
+
+    // Remove an entry (caller holds the shard mutex)
+    static void Erase(Shard& shard, std::list<Entry>::iterator entry) {
+        shard.bytes -= EntrySize(*entry);
+        shard.index.erase(entry->url);
+        shard.lru.erase(entry);
+    }
+
+    Shard shards[SHARD_COUNT];
+    Counters counters;
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,399 @@
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "request_buffer.h"
+
+// Incremental extraction of output values from a response body.
+//
+// Chunks are fed as curl delivers them and only the part that can end up in an output
+// value is kept, in fixed buffers one byte larger than an output value so a truncated
+// value can still be recognised. The extractor either keeps the start of the body (up
+// to the first NULL, like the buffered path) or picks named fields out of it in a
+// single pass, without building a document: top-level fields of a JSON object, or
+// key=value / key: value lines. Once every value is complete the rest of the body is
+// read and discarded, which keeps the connection reusable; after drainLimit more bytes
+// the transfer is aborted instead, so a large body costs a connection but neither the
+// memory nor the download time.
+class ResponseExtractor {
+public:
+    enum class Format {
+        Prefix,    // The start of the body
+        Json,      // Top-level fields of a JSON object
+        KeyValue   // Lines of key=value or key: value
+    };
+
+    // Start a new response. fieldNames (fieldCount names, ignored for Prefix) must
+    // outlive the response; they point into a configuration snapshot.
+    void Reset(Format bodyFormat, const std::string* fieldNames, size_t fieldCount, size_t drainLimit) {
+        format = bodyFormat;
+        fields = fieldNames;
+        count = format == Format::Prefix ? 1 : fieldCount;
+        drain = drainLimit;
+        values.resize(count * VALUE_SIZE);
+        lengths.assign(count, 0);
+        filled.assign(count, false);
+        remaining = count;
+        discarded = 0;
+        depth = 0;
+        target = NO_TARGET;
+        stoppedEarly = false;
+        switch (format) {
+        case Format::Prefix: state = State::Prefix; break;
+        case Format::Json: state = State::Scan; break;
+        case Format::KeyValue: state = State::LineStart; break;
+        }
+        if (remaining == 0) {
+            state = State::Done;
+        }
+    }
+
+    // Consume a chunk of the body. Returns false when the transfer should be aborted.
+    bool Feed(const char* data, size_t size) {
+        size_t consumed = 0;
+        if (state == State::Prefix) {
+            consumed = FeedPrefix(data, size);
+        } else if (format == Format::Json) {
+            while (consumed < size && state != State::Done) {
+                FeedJson(data[consumed++]);
+            }
+        } else {
+            while (consumed < size && state != State::Done) {
+                FeedLine(data[consumed++]);
+            }
+        }
+
+        discarded += size - consumed;
+        if (state == State::Done && discarded > drain) {
+            stoppedEarly = true;
+            return false;
+        }
+        return true;
+    }
+
+    // Number of values (1 for Prefix)
+    size_t Count() const { return count; }
+
+    // The value of field index (VALUE_SIZE bytes when it had to be truncated, empty if absent)
+    std::string_view Value(size_t index = 0) const {
+        return std::string_view(values.data() + index * VALUE_SIZE, lengths[index]);
+    }
+
+    // Whether Feed aborted the transfer after every value was complete
+    bool StoppedEarly() const { return stoppedEarly; }
+
+    // curl write callback with the extractor as userdata
+    static size_t WriteCallback(char* contents, size_t size, size_t nmemb, void* userdata) {
+        const size_t totalSize = size * nmemb;
+        return static_cast<ResponseExtractor*>(userdata)->Feed(contents, totalSize) ? totalSize : 0;
+    }
+
+private:
+    static constexpr size_t NO_TARGET = static_cast<size_t>(-1);
+    static constexpr size_t MAX_KEY = 64; // Longer names never match
+
+    enum class State {
+        Prefix,       // Keeping the start of the body
+        Scan,         // JSON: outside any string, looking for a key at depth 1
+        Key,          // JSON: inside a string that may be a key
+        AfterKey,     // JSON: after a string, waiting for ':' to tell whether it was a key
+        ValueStart,   // JSON: after a key's ':', skipping whitespace
+        StringValue,  // JSON: inside a string value
+        Escape,       // JSON: after a backslash in a string value
+        Unicode,      // JSON: reading the hex digits of a \u escape
+        RawValue,     // JSON: copying a number, literal, object or array as written
+        LineStart,    // Lines: skipping leading whitespace of a line
+        LineKey,      // Lines: reading a key up to '=' or ':'
+        LineValue,    // Lines: reading a value up to the end of the line
+        Done          // Every value complete, discarding the rest
+    };
+
+    // Keep the body up to the first NULL; returns how many bytes were used
+    size_t FeedPrefix(const char* data, size_t size) {
+        const size_t room = VALUE_SIZE - lengths[0];
+        const size_t take = size < room ? size : room;
+        const void* terminator = memchr(data, '\0', take);
+        const size_t copied = terminator ? static_cast<const char*>(terminator) - data : take;
+        memcpy(values.data() + lengths[0], data, copied);
+        lengths[0] += copied;
+        if (terminator || lengths[0] == VALUE_SIZE) {
+            state = State::Done;
+            return terminator ? copied + 1 : copied;
+        }
+        return copied;
+    }
+
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static int HexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Index of the unfilled field named by the collected key, or NO_TARGET
+    size_t FindTarget() const {
+        if (keyLength > MAX_KEY) {
+            return NO_TARGET;
+        }
+        const std::string_view key(keyText, keyLength);
+        for (size_t i = 0; i < count; i++) {
+            if (!filled[i] && fields[i] == key) {
+                return i;
+            }
+        }
+        return NO_TARGET;
+    }
+
+    void CollectKey(char c) {
+        if (keyLength < MAX_KEY) {
+            keyText[keyLength] = c;
+        }
+        keyLength++;
+    }
+
+    // Add a byte to the current value; a full value of the last missing field ends the scan
+    void Append(char c) {
+        if (target == NO_TARGET) {
+            return;
+        }
+        size_t& length = lengths[target];
+        if (length < VALUE_SIZE) {
+            values[target * VALUE_SIZE + length++] = c;
+        }
+        if (length == VALUE_SIZE && remaining == 1) {
+            FinishValue();
+        }
+    }
+
+    // The current value is complete; go on with the rest of the body or stop
+    void FinishValue() {
+        if (target != NO_TARGET) {
+            filled[target] = true;
+            remaining--;
+            target = NO_TARGET;
+        }
+        if (remaining == 0) {
+            state = State::Done;
+        } else {
+            state = format == Format::Json ? State::Scan : State::LineStart;
+        }
+    }
+
+    void FeedJson(char c) {
+        switch (state) {
+        case State::AfterKey:
+            if (IsSpace(c)) {
+                return;
+            }
+            if (c == ':') {
+                target = depth == 1 ? FindTarget() : NO_TARGET;
+                state = target != NO_TARGET ? State::ValueStart : State::Scan;
+                return;
+            }
+            state = State::Scan;
+            [[fallthrough]];
+        case State::Scan:
+            if (c == '"') {
+                state = State::Key;
+                keyLength = 0;
+                keyEscape = false;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                // The end of the document: the missing fields are not there
+                if (--depth <= 0) {
+                    state = State::Done;
+                }
+            }
+            return;
+        case State::Key:
+            // Escapes are compared as written; field names are plain ASCII
+            if (c == '"' && !keyEscape) {
+                state = State::AfterKey;
+                return;
+            }
+            keyEscape = c == '\\' && !keyEscape;
+            CollectKey(c);
+            return;
+        case State::ValueStart:
+            if (IsSpace(c)) {
+                return;
+            }
+            if (c == '"') {
+                state = State::StringValue;
+                return;
+            }
+            state = State::RawValue;
+            rawDepth = 0;
+            rawInString = false;
+            rawEscape = false;
+            FeedRaw(c);
+            return;
+        case State::StringValue:
+            if (c == '"') {
+                FinishValue();
+            } else if (c == '\\') {
+                state = State::Escape;
+            } else {
+                Append(c);
+            }
+            return;
+        case State::Escape:
+            state = State::StringValue;
+            switch (c) {
+            case 'n': Append('\n'); break;
+            case 't': Append('\t'); break;
+            case 'r': Append('\r'); break;
+            case 'b': Append('\b'); break;
+            case 'f': Append('\f'); break;
+            case 'u':
+                state = State::Unicode;
+                codePoint = 0;
+                hexDigits = 0;
+                break;
+            default: Append(c); break; // \" \\ \/
+            }
+            return;
+        case State::Unicode: {
+            const int digit = HexValue(c);
+            codePoint = codePoint * 16 + (digit < 0 ? 0 : digit);
+            if (++hexDigits < 4) {
+                return;
+            }
+            // The output is ISO-8859-1: keep what it can hold, mark the rest (a surrogate pair once)
+            state = State::StringValue;
+            if (codePoint <= 0xFF) {
+                Append(static_cast<char>(codePoint));
+            } else if (codePoint < 0xDC00 || codePoint > 0xDFFF) {
+                Append('?');
+            }
+            return;
+        }
+        case State::RawValue:
+            FeedRaw(c);
+            return;
+        default:
+            return;
+        }
+    }
+
+    // Copy a non-string value until the delimiter that ends it
+    void FeedRaw(char c) {
+        if (rawInString) {
+            const bool escaped = rawEscape;
+            rawEscape = c == '\\' && !escaped;
+            if (c == '"' && !escaped) {
+                rawInString = false;
+            }
+            Append(c);
+            return;
+        }
+        if (c == '{' || c == '[') {
+            rawDepth++;
+        } else if (c == '}' || c == ']') {
+            if (rawDepth == 0) {
+                // The delimiter closes the enclosing object, which the scan still has to see
+                FinishValue();
+                if (state == State::Scan) {
+                    FeedJson(c);
+                }
+                return;
+            }
+            rawDepth--;
+        } else if (rawDepth == 0 && (c == ',' || IsSpace(c))) {
+            FinishValue();
+            return;
+        } else if (c == '"') {
+            rawInString = true;
+            rawEscape = false;
+        }
+        Append(c);
+
+        // A nested object or array is complete once its closing bracket is copied
+        if (rawDepth == 0 && (c == '}' || c == ']') && state == State::RawValue) {
+            FinishValue();
+        }
+    }
+
+    void FeedLine(char c) {
+        switch (state) {
+        case State::LineStart:
+            if (IsSpace(c)) {
+                return;
+            }
+            state = State::LineKey;
+            keyLength = 0;
+            [[fallthrough]];
+        case State::LineKey:
+            if (c == '=' || c == ':') {
+                // Trailing blanks are not part of the key
+                while (keyLength > 0 && keyLength <= MAX_KEY &&
+                       (keyText[keyLength - 1] == ' ' || keyText[keyLength - 1] == '\t')) {
+                    keyLength--;
+                }
+                target = FindTarget();
+                valueStarted = false;
+                state = State::LineValue;
+            } else if (c == '\r' || c == '\n') {
+                state = State::LineStart;
+            } else {
+                CollectKey(c);
+            }
+            return;
+        case State::LineValue:
+            if (c == '\r' || c == '\n') {
+                if (target != NO_TARGET) {
+                    FinishValue();
+                } else {
+                    state = State::LineStart;
+                }
+                return;
+            }
+            // Leading blanks are not part of the value
+            if (!valueStarted && (c == ' ' || c == '\t')) {
+                return;
+            }
+            valueStarted = true;
+            Append(c);
+            return;
+        default:
+            return;
+        }
+    }
+
+    Format format = Format::Prefix;
+    const std::string* fields = nullptr;
+    size_t count = 0;
+    size_t drain = 0;
+    std::vector<char> values;     // count slots of VALUE_SIZE bytes
+    std::vector<size_t> lengths;
+    std::vector<bool> filled;
+    size_t remaining = 0;         // Fields still missing
+    size_t discarded = 0;
+    bool stoppedEarly = false;
+    State state = State::Prefix;
+
+    // Scanner state
+    size_t target = NO_TARGET;    // Field the current value belongs to
+    char keyText[MAX_KEY];
+    size_t keyLength = 0;
+    bool keyEscape = false;
+    bool valueStarted = false;
+    int depth = 0;                // JSON objects and arrays open around the scan position
+    unsigned int codePoint = 0;
+    int hexDigits = 0;
+    int rawDepth = 0;
+    bool rawInString = false;
+    bool rawEscape = false;
+};
+
+#endif // RESPONSE_STREAM_H
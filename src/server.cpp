@@ -1,103 +1,568 @@
 #include <iostream>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <string>
-#include <map>
+#include <string_view>
+#include <charconv>
+#include <system_error>
+#include <initializer_list>
 #include <chrono>
 #include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <array>
+#include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 // Define a simple HTTP server using only standard libraries
 // This avoids external dependencies and makes it easier to build
 #ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // WSAPoll
+#endif
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+#endif
+
+// Largest request head (request line plus headers) accepted on a connection
+constexpr size_t MAX_REQUEST_HEAD = 8192;
+
+// Largest request body accepted (Content-Length); larger requests are answered with 413
+constexpr size_t MAX_REQUEST_BODY = 1024 * 1024;
+
+// Why parseRequest could not take a request
+enum class RequestError {
+    None,
+    Malformed,    // Answered with 400
+    BodyTooLarge  // Answered with 413
+};
+
+// Value of each hexadecimal digit, -1 for any other character
+constexpr std::array<signed char, 256> makeHexTable() {
+    std::array<signed char, 256> table = {};
+    for (int i = 0; i < 256; i++) {
+        table[i] = -1;
+    }
+    for (int i = 0; i < 10; i++) {
+        table['0' + i] = static_cast<signed char>(i);
+    }
+    for (int i = 0; i < 6; i++) {
+        table['a' + i] = static_cast<signed char>(10 + i);
+        table['A' + i] = static_cast<signed char>(10 + i);
+    }
+    return table;
+}
+constexpr std::array<signed char, 256> HEX_VALUES = makeHexTable();
+
+// ASCII case-insensitive comparison
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ASCII case-insensitive substring search
+inline bool containsIgnoreCase(std::string_view text, std::string_view token) {
+    for (size_t i = 0; i + token.size() <= text.size(); i++) {
+        if (equalsIgnoreCase(text.substr(i, token.size()), token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Decoded query parameters in request order; keys view into the request
+class QueryParams {
+public:
+    void add(std::string_view key, std::string value) {
+        items.push_back({key, std::move(value)});
+    }
+
+    // Value of the first parameter named key, or nullptr if absent
+    const std::string* find(std::string_view key) const {
+        for (const auto& item : items) {
+            if (item.first == key) {
+                return &item.second;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<std::pair<std::string_view, std::string>>::const_iterator begin() const { return items.begin(); }
+    std::vector<std::pair<std::string_view, std::string>>::const_iterator end() const { return items.end(); }
+
+private:
+    std::vector<std::pair<std::string_view, std::string>> items;
+};
+
+// Server tuning from the command line
+// Severity of a log line; lines below the configured level are skipped before formatting
+enum class LogLevel { Debug, Info, Warn, Error, Off };
+
+struct ServerOptions {
+    LogLevel logLevel = LogLevel::Debug; // Debug also logs every query parameter
+    bool eventLoop = false;   // Serve non-blocking sockets from readiness-based event loops
+    int threads = 0;          // Worker threads (or event loops); 0 handles one connection at a time
+    int keepAliveTimeout = 5; // Seconds an idle keep-alive connection is held open
+    int maxRequests = 1000;   // Requests served on one connection before it is closed
+};
+
+// Readiness notification for the event-loop engine: epoll on Linux, WSAPoll on Windows
+// and poll elsewhere. Sockets are level-triggered: a socket is reported for as long as it
+// has data to read (or, with write interest, room to write).
+class EventPoller {
+public:
+    struct Event {
+        int socket;
+        bool readable;
+        bool writable;
+        bool failed;  // Error or hang-up
+    };
+
+#ifdef __linux__
+    EventPoller() : epollFd(epoll_create1(0)) {}
+    ~EventPoller() {
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+
+    bool valid() const { return epollFd >= 0; }
+
+    // Watch a socket for reads; exclusive wakes only one of the loops sharing it (the listener)
+    bool add(int socket, bool exclusive = false) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+        if (exclusive) {
+            event.events |= EPOLLEXCLUSIVE;
+        }
+#endif
+        event.data.fd = socket;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == 0;
+    }
+
+    void setWriteInterest(int socket, bool enabled) {
+        struct epoll_event event = {};
+        event.events = enabled ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = socket;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &event);
+    }
+
+    void remove(int socket) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr);
+    }
+
+    // Wait up to timeoutMs and fill events with the ready sockets
+    void wait(std::vector<Event>& events, int timeoutMs) {
+        struct epoll_event ready[256];
+        events.clear();
+        int count = epoll_wait(epollFd, ready, 256, timeoutMs);
+        for (int i = 0; i < count; i++) {
+            events.push_back({ready[i].data.fd, (ready[i].events & EPOLLIN) != 0,
+                              (ready[i].events & EPOLLOUT) != 0,
+                              (ready[i].events & (EPOLLERR | EPOLLHUP)) != 0});
+        }
+    }
+
+private:
+    int epollFd;
+#else
+#ifdef _WIN32
+    typedef WSAPOLLFD PollDescriptor;
+    static int pollSockets(PollDescriptor* fds, size_t count, int timeoutMs) {
+        return WSAPoll(fds, static_cast<ULONG>(count), timeoutMs);
+    }
+#else
+    typedef struct pollfd PollDescriptor;
+    static int pollSockets(PollDescriptor* fds, size_t count, int timeoutMs) {
+        return poll(fds, static_cast<nfds_t>(count), timeoutMs);
+    }
+#endif
+
+    bool valid() const { return true; }
+
+    bool add(int socket, bool = false) {
+        PollDescriptor descriptor = {};
+        descriptor.fd = socket;
+        descriptor.events = POLLIN;
+        positions[socket] = descriptors.size();
+        descriptors.push_back(descriptor);
+        return true;
+    }
+
+    void setWriteInterest(int socket, bool enabled) {
+        auto found = positions.find(socket);
+        if (found != positions.end()) {
+            descriptors[found->second].events = static_cast<short>(POLLIN | (enabled ? POLLOUT : 0));
+        }
+    }
+
+    void remove(int socket) {
+        auto found = positions.find(socket);
+        if (found == positions.end()) {
+            return;
+        }
+        // Move the last descriptor into the freed position
+        const size_t position = found->second;
+        positions.erase(found);
+        if (position != descriptors.size() - 1) {
+            descriptors[position] = descriptors.back();
+            positions[static_cast<int>(descriptors[position].fd)] = position;
+        }
+        descriptors.pop_back();
+    }
+
+    // Wait up to timeoutMs and fill events with the ready sockets
+    void wait(std::vector<Event>& events, int timeoutMs) {
+        events.clear();
+        if (pollSockets(descriptors.data(), descriptors.size(), timeoutMs) <= 0) {
+            return;
+        }
+        for (const PollDescriptor& descriptor : descriptors) {
+            if (descriptor.revents != 0) {
+                events.push_back({static_cast<int>(descriptor.fd), (descriptor.revents & POLLIN) != 0,
+                                  (descriptor.revents & POLLOUT) != 0,
+                                  (descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+            }
+        }
+    }
+
+private:
+    std::vector<PollDescriptor> descriptors;
+    std::unordered_map<int, size_t> positions;
+#endif
+};
+
+// Local date and time of a Unix time as "YYYY-MM-DD HH:MM:SS"
+inline void formatTimestamp(time_t time, char (&text)[20]) {
+    struct tm localTime;
+#ifdef _WIN32
+    localtime_s(&localTime, &time);
+#else
+    localtime_r(&time, &localTime);
 #endif
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &localTime);
+}
+
+// Asynchronous console logger.
+//
+// Request threads copy each line into a fixed-size slot of a bounded lock-free ring
+// (a multi-producer, single-consumer sequence queue) and return; a background thread
+// formats the timestamps and writes the lines to stdout in batches with one flush per
+// batch. If the ring is full the line is dropped and counted rather than blocking the
+// request, and the writer reports how many were lost. The timestamp string is formatted
+// at most once per second.
+class AsyncLogger {
+public:
+    AsyncLogger(LogLevel level, std::string prefix)
+        : level(level), prefix(std::move(prefix)), slots(new Slot[SLOT_COUNT]) {
+        for (size_t i = 0; i < SLOT_COUNT; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        if (level != LogLevel::Off) {
+            writer = std::thread(&AsyncLogger::writerLoop, this);
+        }
+    }
+
+    ~AsyncLogger() {
+        shutdown();
+    }
+
+    bool enabled(LogLevel lineLevel) const {
+        return lineLevel >= level && level != LogLevel::Off;
+    }
+
+    // Queue a line made of the given pieces (truncated to the slot size)
+    void log(LogLevel lineLevel, std::initializer_list<std::string_view> parts) {
+        if (!enabled(lineLevel) || !writer.joinable()) {
+            return;
+        }
+
+        // Claim a slot
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & (SLOT_COUNT - 1)];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        // Fill and publish it
+        slot->time = time(nullptr);
+        size_t length = 0;
+        for (std::string_view part : parts) {
+            const size_t copied = part.size() < LINE_CAPACITY - length ? part.size() : LINE_CAPACITY - length;
+            memcpy(slot->text + length, part.data(), copied);
+            length += copied;
+        }
+        slot->length = length;
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    // Write every queued line and stop the writer thread
+    void shutdown() {
+        stopping.store(true, std::memory_order_release);
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+private:
+    static constexpr size_t SLOT_COUNT = 8192; // Power of two
+    static constexpr size_t LINE_CAPACITY = 240;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        time_t time;
+        size_t length;
+        char text[LINE_CAPACITY];
+    };
+
+    void writerLoop() {
+        std::string batch;
+        batch.reserve(64 * 1024);
+        time_t formattedTime = 0;
+        char timestamp[20] = "";
+        unsigned long long reportedDrops = 0;
+
+        while (true) {
+            const bool finalPass = stopping.load(std::memory_order_acquire);
+
+            // Drain the ring into one buffer
+            Slot* slot;
+            while (batch.size() < 60 * 1024 && (slot = nextReady()) != nullptr) {
+                if (slot->time != formattedTime) {
+                    formattedTime = slot->time;
+                    formatTimestamp(formattedTime, timestamp);
+                }
+                batch.append("[").append(timestamp).append("] ").append(prefix).append(": ");
+                batch.append(slot->text, slot->length).append("\n");
+                release(slot);
+            }
+
+            const unsigned long long drops = dropped.load(std::memory_order_relaxed);
+            if (drops != reportedDrops) {
+                batch.append(std::to_string(drops - reportedDrops)).append(" log lines dropped (log buffer full)\n");
+                reportedDrops = drops;
+            }
+
+            if (!batch.empty()) {
+                fwrite(batch.data(), 1, batch.size(), stdout);
+                fflush(stdout);
+                batch.clear();
+                continue;
+            }
+            if (finalPass) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    // The oldest published slot, or nullptr if the ring is empty (writer thread only)
+    Slot* nextReady() {
+        Slot& slot = slots[dequeuePosition & (SLOT_COUNT - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    // Hand a consumed slot back to the producers
+    void release(Slot* slot) {
+        slot->sequence.store(dequeuePosition + SLOT_COUNT, std::memory_order_release);
+        dequeuePosition++;
+    }
+
+    const LogLevel level;
+    const std::string prefix;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) size_t dequeuePosition = 0;
+    std::atomic<unsigned long long> dropped{0};
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+};
 
 class SimpleHttpServer {
 private:
     int serverSocket;
     int port;
-    bool running;
-    std::string logPrefix;
-
-    // Helper function to get current timestamp for logging
-    std::string getCurrentTimestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
-        return ss.str();
-    }
-
-    // Log a message with timestamp
-    void log(const std::string& message) {
-        std::cout << "[" << getCurrentTimestamp() << "] " << logPrefix << ": " << message << std::endl;
-    }
-
-    // Parse URL-encoded parameters
-    std::map<std::string, std::string> parseQueryString(const std::string& query) {
-        std::map<std::string, std::string> params;
-        size_t start = 0;
-        size_t end = query.find('&');
-
-        while (start < query.length()) {
-            std::string param;
-            if (end != std::string::npos) {
-                param = query.substr(start, end - start);
-                start = end + 1;
-                end = query.find('&', start);
-            } else {
-                param = query.substr(start);
-                start = query.length();
-            }
+    std::atomic<bool> running;
+    ServerOptions options;
+    AsyncLogger logger;
+
+    // Accepted connections waiting for a worker
+    struct PendingClient {
+        int socket;
+        struct sockaddr_in address;
+    };
+    std::vector<std::thread> workers;
+    std::deque<PendingClient> pendingClients;
+    std::mutex pendingMutex;
+    std::condition_variable pendingReady;
+
+    // One parsed request, viewing into the connection's receive buffer (valid until the
+    // buffer is compacted after the batch of requests has been answered)
+    struct HttpRequest {
+        std::string_view method;
+        std::string_view path;
+        std::string_view httpVersion;
+        std::string_view contentType;
+        std::string_view body;
+        bool keepAlive = false;
+    };
+
+    // Current local time as "YYYY-MM-DD HH:MM:SS", reformatted at most once per second per thread
+    static std::string_view getCurrentTimestamp() {
+        thread_local time_t formattedTime = 0;
+        thread_local char text[20] = "";
+        const time_t now = time(nullptr);
+        if (now != formattedTime) {
+            formattedTime = now;
+            formatTimestamp(now, text);
+        }
+        return std::string_view(text);
+    }
+
+    // Log a line made of the given pieces
+    void log(LogLevel level, std::initializer_list<std::string_view> parts) {
+        logger.log(level, parts);
+    }
+
+    // Log an error and exit, making sure the line is written first
+    [[noreturn]] void fatal(std::initializer_list<std::string_view> parts) {
+        logger.log(LogLevel::Error, parts);
+        logger.shutdown();
+        exit(1);
+    }
+
+    static void closeSocket(int socket) {
+#ifdef _WIN32
+        closesocket(socket);
+#else
+        close(socket);
+#endif
+    }
+
+    static void setNonBlocking(int socket) {
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        ioctlsocket(socket, FIONBIO, &nonBlocking);
+#else
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    }
+
+    // True if the last failed socket call on a non-blocking socket only needs to be retried later
+    static bool wouldBlock() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+    }
+
+    static void setNoDelay(int socket) {
+        int noDelay = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+    }
+
+    // Per-connection state of the event-loop engine
+    struct Connection {
+        std::string clientIP;
+        std::string received;   // Bytes not yet parsed into requests
+        size_t scanFrom = 0;    // Where to resume looking for the end of the request head
+        std::string output;     // Responses not yet written
+        size_t outputSent = 0;
+        bool writeInterest = false; // Waiting for the socket to accept more output
+        int requestsServed = 0;
+        bool closeAfterWrite = false;
+        std::chrono::steady_clock::time_point lastActive;
+    };
+
+    // Parse URL-encoded parameters from a query string or form body into params
+    void parseQueryString(std::string_view query, QueryParams& params) {
+        while (!query.empty()) {
+            const size_t end = query.find('&');
+            const std::string_view param = query.substr(0, end);
+            query = end == std::string_view::npos ? std::string_view() : query.substr(end + 1);
 
             size_t equalPos = param.find('=');
-            if (equalPos != std::string::npos) {
-                std::string key = param.substr(0, equalPos);
-                std::string value = param.substr(equalPos + 1);
-                params[key] = urlDecode(value);
+            if (equalPos != std::string_view::npos) {
+                params.add(param.substr(0, equalPos), urlDecode(param.substr(equalPos + 1)));
             }
         }
-        return params;
     }
 
     // URL decode a string
-    std::string urlDecode(const std::string& encoded) {
+    static std::string urlDecode(std::string_view encoded) {
         std::string result;
-        for (size_t i = 0; i < encoded.length(); ++i) {
-            if (encoded[i] == '%' && i + 2 < encoded.length()) {
-                int value;
-                std::istringstream iss(encoded.substr(i + 1, 2));
-                if (iss >> std::hex >> value) {
-                    result += static_cast<char>(value);
+        result.reserve(encoded.size());
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            const char c = encoded[i];
+            if (c == '%' && i + 2 < encoded.size()) {
+                const int high = HEX_VALUES[static_cast<unsigned char>(encoded[i + 1])];
+                const int low = HEX_VALUES[static_cast<unsigned char>(encoded[i + 2])];
+                if (high >= 0 && low >= 0) {
+                    result += static_cast<char>(high * 16 + low);
                     i += 2;
-                } else {
-                    result += encoded[i];
+                    continue;
                 }
-            } else if (encoded[i] == '+') {
-                result += ' ';
-            } else {
-                result += encoded[i];
             }
+            result += c == '+' ? ' ' : c;
         }
         return result;
     }
 
 public:
-    SimpleHttpServer(int port) : port(port), running(false), logPrefix("Server") {
+    SimpleHttpServer(int port, const ServerOptions& options = ServerOptions())
+        : port(port), running(false), options(options), logger(options.logLevel, "Server") {
 #ifdef _WIN32
         // Initialize Winsock
         WSADATA wsaData;
         int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
         if (result != 0) {
-            log("WSAStartup failed: " + std::to_string(result));
-            exit(1);
+            fatal({"WSAStartup failed: ", std::to_string(result)});
         }
 #endif
     }
@@ -113,8 +578,7 @@ public:
         // Create socket
         serverSocket = socket(AF_INET, SOCK_STREAM, 0);
         if (serverSocket < 0) {
-            log("Error opening socket");
-            exit(1);
+            fatal({"Error opening socket"});
         }
 
         // Set socket options to reuse address
@@ -124,8 +588,7 @@ public:
 #else
         if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
 #endif
-            log("Error setting socket options");
-            exit(1);
+            fatal({"Error setting socket options"});
         }
 
         // Bind socket to port
@@ -135,18 +598,39 @@ public:
         serverAddr.sin_port = htons(port);
 
         if (bind(serverSocket, (struct sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-            log("Error binding socket to port " + std::to_string(port));
-            exit(1);
+            fatal({"Error binding socket to port ", std::to_string(port)});
         }
 
-        // Start listening
-        if (listen(serverSocket, 5) < 0) {
-            log("Error listening on socket");
-            exit(1);
+        // Start listening (a deeper backlog in worker mode absorbs connection bursts)
+        if (listen(serverSocket, options.threads > 0 || options.eventLoop ? SOMAXCONN : 5) < 0) {
+            fatal({"Error listening on socket"});
         }
 
         running = true;
-        log("Server started on port " + std::to_string(port));
+        log(LogLevel::Info, {"Server started on port ", std::to_string(port)});
+
+        // Event-loop engine: every loop accepts from the shared listening socket and
+        // serves its own connections; this thread runs the first loop
+        if (options.eventLoop) {
+            const int loops = options.threads > 0 ? options.threads : 1;
+            log(LogLevel::Info, {"Serving with ", std::to_string(loops), " event loop(s) (keep-alive ",
+                                 std::to_string(options.keepAliveTimeout), "s)"});
+            setNonBlocking(serverSocket);
+            for (int i = 1; i < loops; i++) {
+                workers.emplace_back(&SimpleHttpServer::eventLoop, this);
+            }
+            eventLoop();
+            return;
+        }
+
+        // Start the worker pool
+        if (options.threads > 0) {
+            log(LogLevel::Info, {"Serving with ", std::to_string(options.threads), " worker threads (keep-alive ",
+                                 std::to_string(options.keepAliveTimeout), "s)"});
+            for (int i = 0; i < options.threads; i++) {
+                workers.emplace_back(&SimpleHttpServer::workerLoop, this);
+            }
+        }
 
         // Main server loop
         while (running) {
@@ -159,133 +643,508 @@ public:
             int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
 
             if (clientSocket < 0) {
-                log("Error accepting connection");
+                if (running) {
+                    log(LogLevel::Error, {"Error accepting connection"});
+                }
                 continue;
             }
 
-            // Handle client connection
-            handleClient(clientSocket, clientAddr);
+            if (options.threads > 0) {
+                // Hand the connection to the worker pool
+                {
+                    std::lock_guard<std::mutex> lock(pendingMutex);
+                    pendingClients.push_back({clientSocket, clientAddr});
+                }
+                pendingReady.notify_one();
+            } else {
+                // Handle client connection
+                handleClient(clientSocket, clientAddr, false);
+            }
         }
     }
 
     void stop() {
-        if (running) {
-            running = false;
+        if (running.exchange(false)) {
+            closeSocket(serverSocket);
+
+            // Wake idle workers and wait for them to finish their current connection
+            pendingReady.notify_all();
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+            workers.clear();
+            for (const PendingClient& client : pendingClients) {
+                closeSocket(client.socket);
+            }
+            pendingClients.clear();
+            log(LogLevel::Info, {"Server stopped"});
+        }
+    }
+
+private:
+    // Worker thread: serve queued connections until the server stops
+    void workerLoop() {
+        while (true) {
+            PendingClient client;
+            {
+                std::unique_lock<std::mutex> lock(pendingMutex);
+                pendingReady.wait(lock, [this] { return !running || !pendingClients.empty(); });
+                if (!running) {
+                    return;
+                }
+                client = pendingClients.front();
+                pendingClients.pop_front();
+            }
+            handleClient(client.socket, client.address, true);
+        }
+    }
+
+    // Serve a connection. With keep-alive, requests are read until the client closes the
+    // connection, asks for Connection: close, or stays idle past the keep-alive timeout.
+    // Pipelined requests that arrive together are answered in order with a single send.
+    void handleClient(int clientSocket, const struct sockaddr_in& clientAddr, bool allowKeepAlive) {
+        char clientIP[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+
+        if (allowKeepAlive) {
+            // Bound how long an idle connection can hold a worker
 #ifdef _WIN32
-            closesocket(serverSocket);
+            DWORD idleTimeout = static_cast<DWORD>(options.keepAliveTimeout) * 1000;
+            setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&idleTimeout, sizeof(idleTimeout));
 #else
-            close(serverSocket);
+            struct timeval idleTimeout = {options.keepAliveTimeout, 0};
+            setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &idleTimeout, sizeof(idleTimeout));
 #endif
-            log("Server stopped");
+            // Responses are written whole, so do not hold them back waiting for ACKs
+            setNoDelay(clientSocket);
         }
+
+        std::string received;
+        size_t scanFrom = 0;
+        std::string responses;
+        int requestsServed = 0;
+        bool keepOpen = true;
+        char buffer[4096];
+
+        while (keepOpen) {
+            // Answer every complete request already buffered
+            keepOpen = answerBufferedRequests(received, scanFrom, responses, requestsServed, allowKeepAlive, clientIP);
+
+            // Send the batch of responses
+            if (!responses.empty()) {
+                if (!sendAll(clientSocket, responses)) {
+                    break;
+                }
+                responses.clear();
+            }
+            if (!keepOpen) {
+                break;
+            }
+
+            // Receive more data
+#ifdef _WIN32
+            int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+#else
+            ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
+#endif
+            if (bytesRead <= 0) {
+                // Client closed the connection or the idle timeout expired
+                if (requestsServed == 0) {
+                    log(LogLevel::Warn, {"Error reading from socket or client disconnected"});
+                }
+                break;
+            }
+            received.append(buffer, static_cast<size_t>(bytesRead));
+        }
+
+        closeSocket(clientSocket);
     }
 
-private:
-    void handleClient(int clientSocket, const struct sockaddr_in& clientAddr) {
-        char buffer[4096] = {0};
+    // Event loop: accept connections and serve them with non-blocking reads and writes
+    void eventLoop() {
+        EventPoller poller;
+        if (!poller.valid() || !poller.add(serverSocket, true)) {
+            log(LogLevel::Error, {"Error creating event poller"});
+            return;
+        }
+
+        std::unordered_map<int, Connection> connections;
+        std::vector<EventPoller::Event> events;
+        auto nextIdleSweep = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+        auto closeConnection = [&](int socket) {
+            poller.remove(socket);
+            closeSocket(socket);
+            connections.erase(socket);
+        };
 
-        // Receive request
+        while (running) {
+            poller.wait(events, 250);
+            const auto now = std::chrono::steady_clock::now();
+
+            for (const EventPoller::Event& event : events) {
+                if (event.socket == serverSocket) {
+                    acceptConnections(poller, connections, now);
+                    continue;
+                }
+
+                auto found = connections.find(event.socket);
+                if (found == connections.end()) {
+                    continue;
+                }
+                Connection& connection = found->second;
+                bool open = true;
+
+                if (event.readable || event.failed) {
+                    open = readAvailable(event.socket, connection);
+                    connection.lastActive = now;
+                }
+                if (open && !connection.closeAfterWrite) {
+                    const bool keepOpen = answerBufferedRequests(connection.received, connection.scanFrom,
+                        connection.output, connection.requestsServed, true, connection.clientIP.c_str());
+                    connection.closeAfterWrite = !keepOpen;
+                }
+                if (open && (event.writable || !connection.output.empty())) {
+                    open = flushOutput(event.socket, connection, poller);
+                }
+                if (!open || (connection.closeAfterWrite && connection.output.empty())) {
+                    closeConnection(event.socket);
+                }
+            }
+
+            // Close keep-alive connections that have been idle too long
+            if (now >= nextIdleSweep) {
+                const auto idleLimit = std::chrono::seconds(options.keepAliveTimeout);
+                std::vector<int> idle;
+                for (const auto& entry : connections) {
+                    if (entry.second.output.empty() && now - entry.second.lastActive > idleLimit) {
+                        idle.push_back(entry.first);
+                    }
+                }
+                for (int socket : idle) {
+                    closeConnection(socket);
+                }
+                nextIdleSweep = now + std::chrono::seconds(1);
+            }
+        }
+
+        for (const auto& entry : connections) {
+            closeSocket(entry.first);
+        }
+    }
+
+    // Accept every pending connection on the non-blocking listening socket
+    void acceptConnections(EventPoller& poller, std::unordered_map<int, Connection>& connections,
+                           std::chrono::steady_clock::time_point now) {
+        while (running) {
+            struct sockaddr_in clientAddr;
 #ifdef _WIN32
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+            int clientAddrLen = sizeof(clientAddr);
 #else
-        ssize_t bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+            socklen_t clientAddrLen = sizeof(clientAddr);
 #endif
+            int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+            if (clientSocket < 0) {
+                if (!wouldBlock()) {
+                    log(LogLevel::Error, {"Error accepting connection"});
+                }
+                return;
+            }
 
-        if (bytesRead <= 0) {
-            log("Error reading from socket or client disconnected");
+            setNonBlocking(clientSocket);
+            setNoDelay(clientSocket);
+            if (!poller.add(clientSocket)) {
+                closeSocket(clientSocket);
+                continue;
+            }
+
+            char clientIP[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+            Connection& connection = connections[clientSocket];
+            connection.clientIP = clientIP;
+            connection.lastActive = now;
+        }
+    }
+
+    // Read everything the socket has buffered. Returns false once the peer has closed.
+    bool readAvailable(int socket, Connection& connection) {
+        char buffer[16384];
+        while (true) {
 #ifdef _WIN32
-            closesocket(clientSocket);
+            int bytesRead = recv(socket, buffer, sizeof(buffer), 0);
 #else
-            close(clientSocket);
+            ssize_t bytesRead = recv(socket, buffer, sizeof(buffer), 0);
 #endif
-            return;
+            if (bytesRead > 0) {
+                connection.received.append(buffer, static_cast<size_t>(bytesRead));
+                if (connection.received.size() > MAX_REQUEST_HEAD * 4) {
+                    return true; // Parse what we have before reading more
+                }
+                continue;
+            }
+            return bytesRead < 0 && wouldBlock();
+        }
+    }
+
+    // Write as much pending output as the socket accepts, watching for writability while
+    // some remains. Returns false if the connection failed.
+    bool flushOutput(int socket, Connection& connection, EventPoller& poller) {
+        while (connection.outputSent < connection.output.size()) {
+            const char* data = connection.output.data() + connection.outputSent;
+            const size_t remaining = connection.output.size() - connection.outputSent;
+#ifdef _WIN32
+            int result = send(socket, data, static_cast<int>(remaining), 0);
+#else
+            ssize_t result = send(socket, data, remaining, 0);
+#endif
+            if (result <= 0) {
+                if (result < 0 && wouldBlock()) {
+                    if (!connection.writeInterest) {
+                        poller.setWriteInterest(socket, true);
+                        connection.writeInterest = true;
+                    }
+                    return true;
+                }
+                return false;
+            }
+            connection.outputSent += static_cast<size_t>(result);
+        }
+
+        connection.output.clear();
+        connection.outputSent = 0;
+        if (connection.writeInterest) {
+            poller.setWriteInterest(socket, false);
+            connection.writeInterest = false;
+        }
+        return true;
+    }
+
+    // Answer every complete request at the front of received, appending the responses.
+    // Returns false when the connection should be closed after the responses are sent.
+    bool answerBufferedRequests(std::string& received, size_t& scanFrom, std::string& responses,
+                                int& requestsServed, bool allowKeepAlive, const char* clientIP) {
+        HttpRequest request;
+        size_t consumed = 0;
+        RequestError error = RequestError::None;
+        bool keepOpen = true;
+        while (keepOpen && parseRequest(received, consumed, scanFrom, request, error)) {
+            requestsServed++;
+            keepOpen = allowKeepAlive && request.keepAlive && requestsServed < options.maxRequests;
+            handleRequest(responses, request, clientIP, keepOpen);
+        }
+        received.erase(0, consumed);
+        scanFrom -= consumed;
+
+        if (error == RequestError::BodyTooLarge) {
+            appendResponse(responses, "413 Payload Too Large", {"Error: Request body too large"}, false);
+            keepOpen = false;
+        } else if (error == RequestError::Malformed) {
+            appendResponse(responses, "400 Bad Request", {"Error: Malformed request"}, false);
+            keepOpen = false;
+        }
+        return keepOpen;
+    }
+
+    // Take one complete request from received, starting at offset. Returns false when more
+    // data is needed; sets error if the request can never be taken. scanFrom remembers
+    // how far the search for the end of the head got, so a request that arrives in many
+    // small reads is not rescanned from the start each time.
+    bool parseRequest(const std::string& received, size_t& offset, size_t& scanFrom, HttpRequest& request,
+                      RequestError& error) {
+        const size_t headEnd = received.find("\r\n\r\n", scanFrom > offset ? scanFrom : offset);
+        if (headEnd == std::string::npos) {
+            // A head that has not ended within the limit never will; a body may be longer
+            if (received.size() - offset > MAX_REQUEST_HEAD) {
+                error = RequestError::Malformed;
+                return false;
+            }
+            scanFrom = received.size() > offset + 3 ? received.size() - 3 : offset;
+            return false;
+        }
+        scanFrom = offset;
+
+        // Request line: method, target and version separated by single spaces
+        const std::string_view head(received.data() + offset, headEnd - offset);
+        const size_t lineEnd = head.find("\r\n");
+        const std::string_view requestLine = head.substr(0, lineEnd);
+        const size_t methodEnd = requestLine.find(' ');
+        const size_t pathEnd = methodEnd == std::string_view::npos ? methodEnd : requestLine.find(' ', methodEnd + 1);
+        request = HttpRequest();
+        if (methodEnd == 0 || pathEnd == std::string_view::npos || pathEnd == methodEnd + 1) {
+            error = RequestError::Malformed;
+            return false;
+        }
+        request.method = requestLine.substr(0, methodEnd);
+        request.path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        request.httpVersion = requestLine.substr(pathEnd + 1);
+
+        // HTTP/1.1 keeps the connection open unless asked otherwise, HTTP/1.0 only when asked
+        request.keepAlive = request.httpVersion == "HTTP/1.1";
+        size_t contentLength = 0;
+        std::string_view headers = lineEnd == std::string_view::npos ? std::string_view() : head.substr(lineEnd + 2);
+        while (!headers.empty()) {
+            const size_t end = headers.find("\r\n");
+            const std::string_view header = headers.substr(0, end);
+            headers = end == std::string_view::npos ? std::string_view() : headers.substr(end + 2);
+
+            const size_t colon = header.find(':');
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+            const std::string_view name = header.substr(0, colon);
+            std::string_view value = header.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ') {
+                value.remove_prefix(1);
+            }
+
+            if (equalsIgnoreCase(name, "connection")) {
+                if (containsIgnoreCase(value, "close")) {
+                    request.keepAlive = false;
+                } else if (containsIgnoreCase(value, "keep-alive")) {
+                    request.keepAlive = true;
+                }
+            } else if (equalsIgnoreCase(name, "content-length")) {
+                while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                    value.remove_suffix(1);
+                }
+                const std::from_chars_result parsed =
+                    std::from_chars(value.data(), value.data() + value.size(), contentLength);
+                if (parsed.ec == std::errc::result_out_of_range) {
+                    error = RequestError::BodyTooLarge;
+                    return false;
+                }
+                if (parsed.ec != std::errc() || parsed.ptr != value.data() + value.size()) {
+                    error = RequestError::Malformed;
+                    return false;
+                }
+            } else if (equalsIgnoreCase(name, "content-type")) {
+                request.contentType = value;
+            }
+        }
+
+        // Wait for the whole body (only form-encoded POST bodies are read). The cap also keeps
+        // the end of the request from overflowing.
+        if (contentLength > MAX_REQUEST_BODY) {
+            error = RequestError::BodyTooLarge;
+            return false;
+        }
+        const size_t requestEnd = headEnd + 4 + contentLength;
+        if (received.size() < requestEnd) {
+            return false;
+        }
+        request.body = std::string_view(received.data() + headEnd + 4, contentLength);
+        offset = requestEnd;
+        scanFrom = requestEnd;
+        return true;
+    }
+
+    // Send the whole buffer, returning false if the connection failed
+    static bool sendAll(int socket, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+#ifdef _WIN32
+            int result = send(socket, data.c_str() + sent, static_cast<int>(data.size() - sent), 0);
+#else
+            ssize_t result = send(socket, data.c_str() + sent, data.size() - sent, 0);
+#endif
+            if (result <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(result);
         }
+        return true;
+    }
+
+    // Append a complete HTTP response to out. The body is given in pieces so it can be
+    // written straight into the output buffer, which is grown once to the exact size.
+    static void appendResponse(std::string& out, std::string_view status,
+                               std::initializer_list<std::string_view> body, bool keepAlive) {
+        size_t bodyLength = 0;
+        for (std::string_view piece : body) {
+            bodyLength += piece.size();
+        }
+        char lengthDigits[24];
+        const char* lengthEnd = std::to_chars(lengthDigits, lengthDigits + sizeof(lengthDigits), bodyLength).ptr;
+        const std::string_view length(lengthDigits, static_cast<size_t>(lengthEnd - lengthDigits));
 
-        // Parse HTTP request
-        std::string request(buffer);
-        std::string method, path, httpVersion;
-        std::istringstream requestStream(request);
-        requestStream >> method >> path >> httpVersion;
+        constexpr std::string_view statusPrefix = "HTTP/1.1 ";
+        constexpr std::string_view contentType = "\r\nContent-Type: text/plain\r\nContent-Length: ";
+        const std::string_view connection = keepAlive ? "\r\nConnection: keep-alive\r\n\r\n"
+                                                      : "\r\nConnection: close\r\n\r\n";
+        out.reserve(out.size() + statusPrefix.size() + status.size() + contentType.size() + length.size() +
+                    connection.size() + bodyLength);
+        out.append(statusPrefix).append(status).append(contentType).append(length).append(connection);
+        for (std::string_view piece : body) {
+            out.append(piece);
+        }
+    }
+
+    // Generate the response for one request and append it to out
+    void handleRequest(std::string& out, const HttpRequest& request, const char* clientIP, bool keepAlive) {
+        std::string_view path = request.path;
 
         // Log the request
-        char clientIP[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
-        log("Request from " + std::string(clientIP) + ": " + method + " " + path);
+        log(LogLevel::Info, {"Request from ", clientIP, ": ", request.method, " ", path});
 
         // Parse query parameters
-        std::map<std::string, std::string> params;
+        QueryParams params;
         size_t queryPos = path.find('?');
-        if (queryPos != std::string::npos) {
-            std::string query = path.substr(queryPos + 1);
+        if (queryPos != std::string_view::npos) {
+            parseQueryString(path.substr(queryPos + 1), params);
             path = path.substr(0, queryPos);
-            params = parseQueryString(query);
+        }
+
+        // Form-encoded POST bodies carry parameters the same way
+        if (request.method == "POST" && containsIgnoreCase(request.contentType, "application/x-www-form-urlencoded")) {
+            parseQueryString(request.body, params);
         }
 
         // Log parameters
-        for (const auto& param : params) {
-            log("Parameter: " + param.first + " = " + param.second);
+        if (logger.enabled(LogLevel::Debug)) {
+            for (const auto& param : params) {
+                log(LogLevel::Debug, {"Parameter: ", param.first, " = ", param.second});
+            }
         }
 
         // Generate response based on path and parameters
-        std::string response;
         if (path == "/api/index.php") {
             // Check if endpoint parameter exists
-            if (params.find("endpoint") != params.end()) {
-                std::string endpoint = params["endpoint"];
-
+            if (const std::string* endpoint = params.find("endpoint")) {
                 // Simulate different endpoint behaviors
-                if (endpoint == "procesareDate_1") {
+                if (*endpoint == "procesareDate_1") {
                     // Check for required parameters
-                    if (params.find("tel") != params.end() && 
-                        params.find("CIF") != params.end() && 
-                        params.find("CID") != params.end()) {
-
+                    const std::string* tel = params.find("tel");
+                    const std::string* cif = params.find("CIF");
+                    const std::string* cid = params.find("CID");
+                    if (tel && cif && cid) {
                         // Generate a response with the parameters
-                        response = "HTTP/1.1 200 OK\r\n";
-                        response += "Content-Type: text/plain\r\n";
-                        response += "Connection: close\r\n\r\n";
-                        response += "Success! Processed request for:\r\n";
-                        response += "Tel: " + params["tel"] + "\r\n";
-                        response += "CIF: " + params["CIF"] + "\r\n";
-                        response += "CID: " + params["CID"] + "\r\n";
-                        response += "Timestamp: " + getCurrentTimestamp() + "\r\n";
-                    } else {
-                        // Missing required parameters
-                        response = "HTTP/1.1 400 Bad Request\r\n";
-                        response += "Content-Type: text/plain\r\n";
-                        response += "Connection: close\r\n\r\n";
-                        response += "Error: Missing required parameters (tel, CIF, CID)";
+                        const std::string_view timestamp = getCurrentTimestamp();
+                        appendResponse(out, "200 OK", {"Success! Processed request for:\r\n",
+                                                       "Tel: ", *tel, "\r\n",
+                                                       "CIF: ", *cif, "\r\n",
+                                                       "CID: ", *cid, "\r\n",
+                                                       "Timestamp: ", timestamp, "\r\n"}, keepAlive);
+                        return;
                     }
-                } else {
-                    // Unknown endpoint
-                    response = "HTTP/1.1 404 Not Found\r\n";
-                    response += "Content-Type: text/plain\r\n";
-                    response += "Connection: close\r\n\r\n";
-                    response += "Error: Unknown endpoint '" + endpoint + "'";
+
+                    // Missing required parameters
+                    appendResponse(out, "400 Bad Request", {"Error: Missing required parameters (tel, CIF, CID)"},
+                                   keepAlive);
+                    return;
                 }
-            } else {
-                // Missing endpoint parameter
-                response = "HTTP/1.1 400 Bad Request\r\n";
-                response += "Content-Type: text/plain\r\n";
-                response += "Connection: close\r\n\r\n";
-                response += "Error: Missing 'endpoint' parameter";
+
+                // Unknown endpoint
+                appendResponse(out, "404 Not Found", {"Error: Unknown endpoint '", *endpoint, "'"}, keepAlive);
+                return;
             }
-        } else {
-            // Unknown path
-            response = "HTTP/1.1 404 Not Found\r\n";
-            response += "Content-Type: text/plain\r\n";
-            response += "Connection: close\r\n\r\n";
-            response += "Error: Path not found";
+
+            // Missing endpoint parameter
+            appendResponse(out, "400 Bad Request", {"Error: Missing 'endpoint' parameter"}, keepAlive);
+            return;
         }
 
-        // Send response
-#ifdef _WIN32
-        send(clientSocket, response.c_str(), response.length(), 0);
-        closesocket(clientSocket);
-#else
-        send(clientSocket, response.c_str(), response.length(), 0);
-        close(clientSocket);
-#endif
+        // Unknown path
+        appendResponse(out, "404 Not Found", {"Error: Path not found"}, keepAlive);
     }
 };
 
@@ -296,11 +1155,35 @@ int main(int argc, char* argv[]) {
     int port = 8080;
 #endif
 
+#ifndef _WIN32
+    // A client closing mid-response must not terminate the server
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    ServerOptions options;
+
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "--port" && i + 1 < argc) {
             port = std::stoi(argv[++i]);
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            const std::string level = argv[++i];
+            options.logLevel = level == "info" ? LogLevel::Info
+                : level == "warn" ? LogLevel::Warn
+                : level == "error" ? LogLevel::Error
+                : level == "off" ? LogLevel::Off
+                : LogLevel::Debug;
+        } else if (arg == "--quiet") {
+            options.logLevel = LogLevel::Off;
+        } else if (arg == "--event-loop") {
+            options.eventLoop = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+        } else if (arg == "--keepalive-timeout" && i + 1 < argc) {
+            options.keepAliveTimeout = std::stoi(argv[++i]);
+        } else if (arg == "--max-requests" && i + 1 < argc) {
+            options.maxRequests = std::stoi(argv[++i]);
         }
     }
 
@@ -309,7 +1192,7 @@ int main(int argc, char* argv[]) {
     std::cout << "Press Ctrl+C to stop the server." << std::endl;
 
     // Start the server
-    SimpleHttpServer server(port);
+    SimpleHttpServer server(port, options);
     server.start();
 
     return 0;
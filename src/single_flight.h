@@ -0,0 +1,93 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <curl/curl.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Request coalescing for identical in-flight calls.
+//
+// The first caller for a key (the leader) performs the request; callers arriving with
+// the same key while it is in flight (followers) wait for it and receive a copy of
+// its outcome instead of sending their own request. The table only holds keys that
+// are in flight right now, so a completed call is never reused; caching is the
+// response cache's job. The mutex is held only for the map lookup, never across I/O.
+class SingleFlight {
+public:
+    struct Counters {
+        std::atomic<unsigned long long> leaders{0};   // Calls that went to the backend
+        std::atomic<unsigned long long> coalesced{0}; // Calls that shared a leader's result
+    };
+
+    // Perform fetch(responseData, httpCode) once for all concurrent callers with this key
+    template <typename Fetch>
+    CURLcode Do(const std::string& key, std::string& responseData, long& httpCode, Fetch&& fetch) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        auto found = calls.find(key);
+        if (found != calls.end()) {
+            // Follower: wait for the leader and copy its outcome
+            std::shared_ptr<Call> call = found->second;
+            call->followers++;
+            counters.coalesced.fetch_add(1, std::memory_order_relaxed);
+            call->finished.wait(lock, [&] { return call->done; });
+
+            responseData = call->responseData;
+            httpCode = call->httpCode;
+            return call->result;
+        }
+
+        // Leader: publish the call, then perform it without holding the lock
+        std::shared_ptr<Call> call = std::make_shared<Call>();
+        calls.emplace(key, call);
+        counters.leaders.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+
+        CURLcode result = CURLE_FAILED_INIT;
+        try {
+            result = fetch(responseData, httpCode);
+        } catch (...) {
+            Complete(key, *call, CURLE_FAILED_INIT, 0, nullptr);
+            throw;
+        }
+
+        Complete(key, *call, result, httpCode, &responseData);
+        return result;
+    }
+
+    const Counters& GetCounters() const { return counters; }
+
+private:
+    struct Call {
+        std::condition_variable finished;
+        CURLcode result = CURLE_OK;
+        long httpCode = 0;
+        std::string responseData;
+        size_t followers = 0;
+        bool done = false;
+    };
+
+    // Publish the leader's outcome and wake its followers
+    void Complete(const std::string& key, Call& call, CURLcode result, long httpCode,
+                  const std::string* responseData) {
+        std::lock_guard<std::mutex> lock(mutex);
+        calls.erase(key);
+        call.result = result;
+        call.httpCode = httpCode;
+        if (call.followers > 0 && responseData) {
+            call.responseData = *responseData;
+        }
+        call.done = true;
+        call.finished.notify_all();
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Call>> calls;
+    Counters counters;
+};
+
+#endif // SINGLE_FLIGHT_H
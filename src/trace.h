@@ -0,0 +1,324 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32) && __has_include(<TraceLoggingProvider.h>)
+#include <TraceLoggingProvider.h>
+#define TRACE_HAVE_ETW 1
+#endif
+
+#include "custom_dll.h"
+#include "io_engine.h"
+#include "request_buffer.h"
+
+// Where sampled spans go
+enum class TraceOutput {
+    File, // The memory-mapped ring file described in custom_dll.h
+    Etw   // The OScapeDLCapture.CustomDLL event provider (Windows builds with TraceLogging)
+};
+
+// Timing of one sampled call, filled in as it passes through the DLL.
+// Only sampled calls have one, so untraced calls never read the clock.
+class CallTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Start a span with fresh ids
+    CallTrace() : start(Clock::now()), lastMark(start) {
+        span.startMicros = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        std::mt19937_64& random = Random();
+        const unsigned long long high = random();
+        const unsigned long long low = random();
+        memcpy(span.traceId, &high, sizeof(high));
+        memcpy(span.traceId + sizeof(high), &low, sizeof(low));
+        span.spanId = random() | 1; // All-zero ids are invalid
+    }
+
+    // dataIn has been parsed
+    void Parsed() {
+        span.parseMicros = SinceLastMark();
+    }
+
+    // The URL or POST body has been built
+    void Built() {
+        span.buildMicros = SinceLastMark();
+    }
+
+    // The call's transfer finished (sent is false when it joined another call's transfer)
+    void Transferred(bool sent, bool post, CURLcode result, long httpCode, const TransferTimings& timings) {
+        span.curlCode = static_cast<unsigned long long>(result);
+        span.httpCode = static_cast<unsigned long long>(httpCode > 0 ? httpCode : 0);
+        span.flags |= (sent ? TRACE_SPAN_SENT : 0) | (post ? TRACE_SPAN_POST : 0);
+        if (!sent || !timings.valid) {
+            return;
+        }
+        if (timings.newConnection) {
+            span.flags |= TRACE_SPAN_NEW_CONNECTION;
+        }
+        span.dnsMicros = static_cast<unsigned long long>(timings.nameLookup);
+        span.connectMicros = static_cast<unsigned long long>(timings.connect);
+        span.tlsMicros = static_cast<unsigned long long>(timings.appConnect);
+        span.waitMicros = static_cast<unsigned long long>(timings.waiting);
+        span.totalMicros = static_cast<unsigned long long>(timings.total);
+        const long long before = timings.nameLookup + timings.connect + timings.appConnect + timings.waiting;
+        span.downloadMicros = timings.total > before ? static_cast<unsigned long long>(timings.total - before) : 0;
+    }
+
+    // The call returned result
+    const TraceSpan& Finish(long result) {
+        span.result = static_cast<unsigned long long>(result);
+        span.callMicros = static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        return span;
+    }
+
+    // The trace header line for the backend. A traceparent header uses the W3C Trace
+    // Context format; any other header name carries the trace id as 32 hex digits.
+    const char* Header(const std::string& name) {
+        static const char hexDigits[] = "0123456789abcdef";
+        char traceId[33];
+        for (size_t i = 0; i < sizeof(span.traceId); i++) {
+            traceId[2 * i] = hexDigits[span.traceId[i] >> 4];
+            traceId[2 * i + 1] = hexDigits[span.traceId[i] & 0xF];
+        }
+        traceId[32] = '\0';
+        if (EqualsIgnoreCase(name, "traceparent")) {
+            snprintf(header, sizeof(header), "traceparent: 00-%s-%016llx-01", traceId, span.spanId);
+        } else {
+            snprintf(header, sizeof(header), "%s: %s", name.c_str(), traceId);
+        }
+        return header;
+    }
+
+private:
+    // Microseconds since the previous mark
+    unsigned long long SinceLastMark() {
+        const Clock::time_point now = Clock::now();
+        const long long micros = std::chrono::duration_cast<std::chrono::microseconds>(now - lastMark).count();
+        lastMark = now;
+        return static_cast<unsigned long long>(micros);
+    }
+
+    // Per-thread id generator, seeded once per thread
+    static std::mt19937_64& Random() {
+        thread_local std::mt19937_64 random(std::random_device{}() ^
+                                            std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        return random;
+    }
+
+    TraceSpan span{};
+    Clock::time_point start;
+    Clock::time_point lastMark;
+    char header[128];
+};
+
+// Ring of spans in a memory-mapped file (layout in custom_dll.h).
+// Writers claim a slot with one atomic increment and never wait for each other or for
+// the reader; a reader that falls more than capacity spans behind loses the oldest ones.
+class TraceRing {
+public:
+    // Map the file, creating or resetting it when its layout does not match.
+    // Returns false if the file cannot be mapped.
+    bool Open(const std::string& path, unsigned long long capacity) {
+        this->path = path;
+        const unsigned long long size = sizeof(TraceFileHeader) + capacity * sizeof(TraceSpan);
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                                     static_cast<DWORD>(size), nullptr);
+        if (!mapping) {
+            Close();
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<size_t>(size));
+        if (!view) {
+            Close();
+            return false;
+        }
+
+        header = static_cast<TraceFileHeader*>(view);
+        spans = reinterpret_cast<TraceSpan*>(header + 1);
+        if (header->magic != TRACE_FILE_MAGIC || header->version != TRACE_FILE_VERSION ||
+            header->spanSize != sizeof(TraceSpan) || header->capacity != capacity) {
+            memset(view, 0, static_cast<size_t>(size));
+            header->version = TRACE_FILE_VERSION;
+            header->spanSize = sizeof(TraceSpan);
+            header->capacity = capacity;
+            header->magic = TRACE_FILE_MAGIC;
+        }
+        this->capacity = capacity;
+        return true;
+    }
+
+    void Write(const TraceSpan& span) {
+        const unsigned long long n = Atomic(header->next).fetch_add(1, std::memory_order_relaxed);
+        TraceSpan& slot = spans[n % capacity];
+        std::atomic<unsigned long long>& sequence = Atomic(slot.sequence);
+
+        sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(reinterpret_cast<char*>(&slot) + sizeof(slot.sequence),
+               reinterpret_cast<const char*>(&span) + sizeof(span.sequence), sizeof(span) - sizeof(span.sequence));
+        sequence.store(2 * n + 2, std::memory_order_release);
+    }
+
+    // The file this ring was opened on
+    const std::string& Path() const { return path; }
+
+    void Close() {
+        if (header) {
+            UnmapViewOfFile(header);
+            header = nullptr;
+            spans = nullptr;
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+    }
+
+private:
+    // The file's 64-bit counters, updated atomically in place
+    static std::atomic<unsigned long long>& Atomic(unsigned long long& value) {
+        static_assert(sizeof(std::atomic<unsigned long long>) == sizeof(unsigned long long) &&
+                      std::atomic<unsigned long long>::is_always_lock_free,
+                      "Counters in the mapped file are updated as lock-free atomics");
+        return *reinterpret_cast<std::atomic<unsigned long long>*>(&value);
+    }
+
+    std::string path;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    TraceFileHeader* header = nullptr;
+    TraceSpan* spans = nullptr;
+    unsigned long long capacity = 0;
+};
+
+#ifdef TRACE_HAVE_ETW
+// {5b0c9c3e-7f4a-4d52-9a61-2f1e8c0d4b7a}
+TRACELOGGING_DEFINE_PROVIDER(g_traceProvider, "OScapeDLCapture.CustomDLL",
+                             (0x5b0c9c3e, 0x7f4a, 0x4d52, 0x9a, 0x61, 0x2f, 0x1e, 0x8c, 0x0d, 0x4b, 0x7a));
+#endif
+
+// Sampling and output of call spans ([trace] section).
+// The ring file and the ETW provider are opened by the first sampled call, not from
+// DllMain, and stay open until the DLL is shut down.
+class Tracer {
+public:
+    struct Settings {
+        TraceOutput output;
+        const std::string* file; // Ring file path
+        long ringSpans;          // Span slots in the ring file
+    };
+
+    // Whether this thread's next call is traced: one call in every sampleEvery
+    static bool Sample(long sampleEvery) {
+        thread_local unsigned long calls = 0;
+        return sampleEvery <= 1 || ++calls % static_cast<unsigned long>(sampleEvery) == 0;
+    }
+
+    void Emit(const TraceSpan& span, const Settings& settings) {
+        if (settings.output == TraceOutput::Etw) {
+#ifdef TRACE_HAVE_ETW
+            EmitEtw(span);
+#endif
+            return;
+        }
+        if (TraceRing* ring = Ring(settings)) {
+            ring->Write(span);
+        }
+    }
+
+    // Close the ring file and unregister the ETW provider (CustomDllShutdown)
+    void Shutdown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (TraceRing* ring = current.exchange(nullptr, std::memory_order_acq_rel)) {
+            ring->Close();
+        }
+#ifdef TRACE_HAVE_ETW
+        if (etwRegistered.exchange(false)) {
+            TraceLoggingUnregister(g_traceProvider);
+        }
+#endif
+    }
+
+private:
+    // The ring for the configured file, opened on first use and reopened if the path
+    // changes. A replaced ring stays mapped, since other threads may still be writing to it.
+    TraceRing* Ring(const Settings& settings) {
+        TraceRing* ring = current.load(std::memory_order_acquire);
+        if (ring && ring->Path() == *settings.file) {
+            return ring;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ring = current.load(std::memory_order_acquire);
+        if (ring && ring->Path() == *settings.file) {
+            return ring;
+        }
+        if (failedPath == *settings.file) {
+            return nullptr; // Do not retry a file that could not be mapped on every call
+        }
+        TraceRing* opened = new TraceRing();
+        if (!opened->Open(*settings.file, static_cast<unsigned long long>(settings.ringSpans > 0 ? settings.ringSpans : 1))) {
+            delete opened;
+            failedPath = *settings.file;
+            return nullptr;
+        }
+        current.store(opened, std::memory_order_release);
+        return opened;
+    }
+
+#ifdef TRACE_HAVE_ETW
+    void EmitEtw(const TraceSpan& span) {
+        if (!etwRegistered.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!etwRegistered.load(std::memory_order_relaxed)) {
+                TraceLoggingRegister(g_traceProvider);
+                etwRegistered.store(true, std::memory_order_release);
+            }
+        }
+        TraceLoggingWrite(g_traceProvider, "CallSpan",
+                          TraceLoggingBinary(span.traceId, sizeof(span.traceId), "TraceId"),
+                          TraceLoggingUInt64(span.spanId, "SpanId"),
+                          TraceLoggingUInt64(span.callMicros, "CallMicros"),
+                          TraceLoggingUInt64(span.parseMicros, "ParseMicros"),
+                          TraceLoggingUInt64(span.buildMicros, "BuildMicros"),
+                          TraceLoggingUInt64(span.dnsMicros, "DnsMicros"),
+                          TraceLoggingUInt64(span.connectMicros, "ConnectMicros"),
+                          TraceLoggingUInt64(span.tlsMicros, "TlsMicros"),
+                          TraceLoggingUInt64(span.waitMicros, "WaitMicros"),
+                          TraceLoggingUInt64(span.downloadMicros, "DownloadMicros"),
+                          TraceLoggingUInt64(span.totalMicros, "TotalMicros"),
+                          TraceLoggingUInt64(span.result, "Result"),
+                          TraceLoggingUInt64(span.curlCode, "CurlCode"),
+                          TraceLoggingUInt64(span.httpCode, "HttpCode"),
+                          TraceLoggingUInt64(span.flags, "Flags"));
+    }
+
+    std::atomic<bool> etwRegistered{false};
+#endif
+
+    std::mutex mutex;
+    std::atomic<TraceRing*> current{nullptr};
+    std::string failedPath; // Guarded by mutex
+};
+
+#endif // TRACE_H
@@ -0,0 +1,215 @@
+#ifndef URL_ENCODE_H
+#define URL_ENCODE_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define URL_ENCODE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define URL_ENCODE_SSE2 1
+#endif
+
+// Percent-encoding of URL query keys and values (RFC 3986), byte for byte what
+// curl_easy_escape produces: unreserved characters (A-Z a-z 0-9 - . _ ~) pass through
+// and every other byte becomes %XX with uppercase hex digits.
+//
+// Encoding is split into an exact length pass and a write pass, so a whole URL can be
+// sized once and written in place without temporary strings. Both passes look at 16
+// (SSE2) or 32 (AVX2) bytes at a time; a block that is entirely unreserved, which is
+// most of a typical value, is counted or copied as one unit, and only blocks with bytes
+// to escape go through the lookup table. Without SSE2 everything uses the table.
+namespace UrlEncode {
+
+// Unreserved bytes, which are copied as they are
+struct UnreservedTable {
+    bool unreserved[256] = {};
+
+    constexpr UnreservedTable() {
+        for (int c = 'A'; c <= 'Z'; c++) unreserved[c] = true;
+        for (int c = 'a'; c <= 'z'; c++) unreserved[c] = true;
+        for (int c = '0'; c <= '9'; c++) unreserved[c] = true;
+        unreserved[static_cast<unsigned char>('-')] = true;
+        unreserved[static_cast<unsigned char>('.')] = true;
+        unreserved[static_cast<unsigned char>('_')] = true;
+        unreserved[static_cast<unsigned char>('~')] = true;
+    }
+};
+
+inline constexpr UnreservedTable TABLE;
+
+inline bool IsUnreserved(char c) {
+    return TABLE.unreserved[static_cast<unsigned char>(c)];
+}
+
+// Write one byte, escaped if needed; returns the position after it
+inline char* EncodeByte(char* out, char c) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    if (IsUnreserved(c)) {
+        *out++ = c;
+        return out;
+    }
+    const unsigned char byte = static_cast<unsigned char>(c);
+    out[0] = '%';
+    out[1] = hexDigits[byte >> 4];
+    out[2] = hexDigits[byte & 0xF];
+    return out + 3;
+}
+
+#if defined(URL_ENCODE_AVX2)
+constexpr size_t BLOCK_SIZE = 32;
+using Block = __m256i;
+
+inline Block LoadBlock(const char* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+inline void StoreBlock(char* out, Block block) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), block);
+}
+
+// Byte i of the result is set when byte i of the block is in [low, high].
+// The compares are signed, so bytes above 0x7F (negative) are never in range.
+inline Block InRange(Block block, char low, char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8(static_cast<char>(low - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high + 1)), block));
+}
+
+inline Block Equals(Block block, char c) {
+    return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c));
+}
+
+inline Block Or(Block a, Block b) {
+    return _mm256_or_si256(a, b);
+}
+
+inline Block SetLowercaseBit(Block block) {
+    return _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+}
+
+inline unsigned int MoveMask(Block block) {
+    return static_cast<unsigned int>(_mm256_movemask_epi8(block));
+}
+
+constexpr unsigned int FULL_MASK = 0xFFFFFFFFu;
+#elif defined(URL_ENCODE_SSE2)
+constexpr size_t BLOCK_SIZE = 16;
+using Block = __m128i;
+
+inline Block LoadBlock(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline void StoreBlock(char* out, Block block) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), block);
+}
+
+// Byte i of the result is set when byte i of the block is in [low, high].
+// The compares are signed, so bytes above 0x7F (negative) are never in range.
+inline Block InRange(Block block, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(low - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(high + 1)), block));
+}
+
+inline Block Equals(Block block, char c) {
+    return _mm_cmpeq_epi8(block, _mm_set1_epi8(c));
+}
+
+inline Block Or(Block a, Block b) {
+    return _mm_or_si128(a, b);
+}
+
+inline Block SetLowercaseBit(Block block) {
+    return _mm_or_si128(block, _mm_set1_epi8(0x20));
+}
+
+inline unsigned int MoveMask(Block block) {
+    return static_cast<unsigned int>(_mm_movemask_epi8(block));
+}
+
+constexpr unsigned int FULL_MASK = 0xFFFFu;
+#endif
+
+#if defined(URL_ENCODE_AVX2) || defined(URL_ENCODE_SSE2)
+// Bit i is set when byte i of the block is unreserved
+inline unsigned int UnreservedMask(Block block) {
+    // Setting 0x20 folds A-Z onto a-z without moving any other byte into that range
+    Block unreserved = InRange(SetLowercaseBit(block), 'a', 'z');
+    unreserved = Or(unreserved, InRange(block, '0', '9'));
+    unreserved = Or(unreserved, InRange(block, '-', '.'));
+    unreserved = Or(unreserved, Equals(block, '_'));
+    unreserved = Or(unreserved, Equals(block, '~'));
+    return MoveMask(unreserved);
+}
+
+inline unsigned int PopCount(unsigned int mask) {
+    unsigned int count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+#endif
+
+// Length of text once encoded
+inline size_t EncodedLength(std::string_view text) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t length = size;
+    size_t i = 0;
+#if defined(URL_ENCODE_AVX2) || defined(URL_ENCODE_SSE2)
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+        const unsigned int mask = UnreservedMask(LoadBlock(data + i));
+        if (mask != FULL_MASK) {
+            length += 2 * (BLOCK_SIZE - PopCount(mask));
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (!IsUnreserved(data[i])) {
+            length += 2;
+        }
+    }
+    return length;
+}
+
+// Write the encoded text to out, which must have room for EncodedLength(text) bytes;
+// returns the position after it
+inline char* EncodeTo(char* out, std::string_view text) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t i = 0;
+#if defined(URL_ENCODE_AVX2) || defined(URL_ENCODE_SSE2)
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+        const Block block = LoadBlock(data + i);
+        const unsigned int mask = UnreservedMask(block);
+        if (mask == FULL_MASK) {
+            StoreBlock(out, block);
+            out += BLOCK_SIZE;
+            continue;
+        }
+        for (size_t j = 0; j < BLOCK_SIZE; j++) {
+            out = EncodeByte(out, data[i + j]);
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        out = EncodeByte(out, data[i]);
+    }
+    return out;
+}
+
+// Append the encoded text to out
+inline void Append(std::string& out, std::string_view text) {
+    const size_t start = out.size();
+    out.resize(start + EncodedLength(text));
+    EncodeTo(&out[start], text);
+}
+
+} // namespace UrlEncode
+
+#endif // URL_ENCODE_H
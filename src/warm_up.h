@@ -0,0 +1,136 @@
+#ifndef WARM_UP_H
+#define WARM_UP_H
+
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_engine.h"
+#include "module_pin.h"
+
+// Background warm-up of the backend connections ([warmup] section).
+//
+// Without it the first calls after the DLL loads pay for the name lookup, the TCP connect
+// and the TLS handshake, and a distant backend can push them past connect_timeout. The
+// warm-up sends HEAD requests to every backend node from its own thread instead:
+//
+// - With the shared engine, `connections` requests per node go out together, and the
+//   connections they open stay in the engine's cache for the calls that follow.
+// - Per-thread handles cannot take over a connection opened on another thread, so one
+//   request per node on a temporary handle fills the shared DNS and TLS session caches;
+//   the first call on each thread then skips the lookup and resumes the TLS session.
+//
+// The thread is started by the first call or CustomDllInitialize and stopped by
+// CustomDllShutdown, never from DllMain.
+class WarmUp {
+public:
+    struct Settings {
+        std::vector<std::string> urls; // One per backend node
+        TransferOptions options;       // Must stay valid until the warm-up finishes
+        long connections;              // Per node, on the shared engine
+        bool sharedEngine;
+        IoEngine::Limits limits;
+    };
+
+    // Process-wide warm-up (intentionally never destroyed, like IoEngine)
+    static WarmUp& Instance() {
+        static WarmUp* warmUp = new WarmUp();
+        return *warmUp;
+    }
+
+    // Start the warm-up thread, unless it has already been started or stopped
+    void Start(Settings settings) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (started) {
+            return;
+        }
+        started = true;
+        ModulePin::Acquire();
+        worker = std::thread(&WarmUp::Run, this, std::move(settings));
+    }
+
+    // Abort the requests on the temporary handle and keep the warm-up from starting.
+    // Requests on the shared engine are stopped by IoEngine::Shutdown.
+    void Stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        started = true;
+        stopping.store(true, std::memory_order_relaxed);
+    }
+
+    // Wait up to timeout for the warm-up thread and join it. Returns false if it is still
+    // running after that; calling it again waits again.
+    bool Wait(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            return true;
+        }
+        if (!workerStopped.wait_for(lock, timeout, [&] { return finished; })) {
+            return false;
+        }
+        lock.unlock();
+        worker.join();
+        return true;
+    }
+
+private:
+    WarmUp() = default;
+
+    static size_t DiscardBody(void*, size_t size, size_t nmemb, void*) {
+        return size * nmemb;
+    }
+
+    static int AbortWhenStopping(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return static_cast<WarmUp*>(userp)->stopping.load(std::memory_order_relaxed) ? 1 : 0;
+    }
+
+    void Run(Settings settings) {
+        settings.options.headOnly = true;
+
+        if (settings.sharedEngine) {
+            // Open the connections side by side so each ends up in the engine's cache
+            std::vector<IoEngine::BatchTransfer> batch;
+            for (const std::string& url : settings.urls) {
+                for (long i = 0; i < settings.connections; i++) {
+                    IoEngine::BatchTransfer& transfer = batch.emplace_back();
+                    transfer.url = url;
+                    transfer.options = settings.options;
+                }
+            }
+            if (!stopping.load(std::memory_order_relaxed)) {
+                IoEngine::Instance().PerformBatch(batch, settings.limits, batch.size());
+            }
+        } else if (CURL* curl = curl_easy_init()) {
+            for (const std::string& url : settings.urls) {
+                if (stopping.load(std::memory_order_relaxed)) {
+                    break;
+                }
+                curl_easy_reset(curl);
+                ApplyTransferOptions(curl, url.c_str(), settings.options);
+                curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardBody);
+                curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+                curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, AbortWhenStopping);
+                curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+                curl_easy_perform(curl);
+            }
+            curl_easy_cleanup(curl);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        workerStopped.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable workerStopped;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    bool started = false;
+    bool finished = false;
+};
+
+#endif // WARM_UP_H
@@ -0,0 +1,246 @@
+// Replay of a capture file written by CustomDLL ([capture] section), shared by
+// TestClient and test_static_dll.
+//
+// The file is memory-mapped and the captured dataIn buffers are passed to the DLL straight
+// from the mapping. Calls are handed out in capture order to a pool of threads, and each
+// starts at its captured time divided by the speed factor, so the replay has the same mix
+// of requests and the same arrival pattern as the calls that were captured. As in the
+// TestClient benchmark, latency is measured from each call's scheduled start.
+
+#ifndef CAPTURE_REPLAY_H
+#define CAPTURE_REPLAY_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "custom_dll.h"
+
+// Signature of CustomFunctionExample and ProcessContactCenterRequest
+typedef long (*ReplayFunction)(const char*, char*);
+
+// One captured call, pointing into the mapped file
+struct CapturedCall {
+    unsigned long long offsetMicros; // Since the first call in the file
+    const char* data;
+    unsigned int size;
+    unsigned int flags;
+};
+
+// Read-only mapping of a capture file and the calls in it
+class CaptureFile {
+public:
+    CaptureFile() = default;
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    ~CaptureFile() {
+        if (!view) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap(view, size);
+#endif
+    }
+
+    // Map the file and index its records. Gaps between calls longer than maxGapMs
+    // (0 = no limit) are shortened to maxGapMs, which keeps a file appended to over several
+    // runs from pausing the replay for the time in between. Returns false with error set
+    // if the file cannot be used.
+    bool open(const std::string& path, long long maxGapMs, std::string& error) {
+        if (!map(path)) {
+            error = "Cannot map " + path;
+            return false;
+        }
+        CaptureFileHeader header;
+        if (size < sizeof(header)) {
+            error = path + " is not a capture file";
+            return false;
+        }
+        memcpy(&header, view, sizeof(header));
+        if (header.magic != CAPTURE_FILE_MAGIC || header.version != CAPTURE_FILE_VERSION ||
+            header.recordSize != sizeof(CaptureRecord)) {
+            error = path + " is not a version " + std::to_string(CAPTURE_FILE_VERSION) + " capture file";
+            return false;
+        }
+
+        const char* bytes = static_cast<const char*>(view);
+        const unsigned long long maxGapMicros = maxGapMs > 0 ? static_cast<unsigned long long>(maxGapMs) * 1000 : 0;
+        unsigned long long previousTimestamp = 0;
+        unsigned long long offset = 0;
+        size_t position = sizeof(header);
+        while (size - position >= sizeof(CaptureRecord)) {
+            CaptureRecord record;
+            memcpy(&record, bytes + position, sizeof(record));
+            if (size - position - sizeof(record) < record.size) {
+                truncated = true; // The DLL was still writing the last record
+                break;
+            }
+            if (!calls_.empty() && record.timestampMicros > previousTimestamp) {
+                const unsigned long long gap = record.timestampMicros - previousTimestamp;
+                offset += maxGapMicros > 0 ? std::min(gap, maxGapMicros) : gap;
+            }
+            previousTimestamp = std::max(previousTimestamp, record.timestampMicros);
+            calls_.push_back({offset, bytes + position + sizeof(record), record.size, record.flags});
+            position += sizeof(record) + record.size;
+        }
+        return true;
+    }
+
+    const std::vector<CapturedCall>& calls() const { return calls_; }
+
+    // Whether the file ended in the middle of a record
+    bool isTruncated() const { return truncated; }
+
+private:
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        HANDLE mapping = size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        if (!mapping) {
+            return false;
+        }
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        view = mapped == MAP_FAILED ? nullptr : mapped;
+#endif
+        return view != nullptr;
+    }
+
+    void* view = nullptr;
+    size_t size = 0;
+    std::vector<CapturedCall> calls_;
+    bool truncated = false;
+};
+
+// Replay settings from the command line
+struct ReplayOptions {
+    double speed = 1.0;     // 2 replays twice as fast as captured; 0 calls back to back
+    int threads = 16;       // Calling threads (the most calls in flight at once)
+    long long maxGapMs = 0; // Longest pause between two calls (0 = as captured)
+};
+
+// Outcome of a replay
+struct ReplayReport {
+    unsigned long long calls = 0;
+    unsigned long long failed = 0;
+    double elapsedSeconds = 0;
+    std::vector<unsigned long long> latencies; // Microseconds, sorted
+};
+
+// Replay every call in the file through function
+inline ReplayReport replayCapture(ReplayFunction function, const CaptureFile& file, const ReplayOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    const std::vector<CapturedCall>& calls = file.calls();
+    const int threads = std::max(1, options.threads);
+    const bool paced = options.speed > 0;
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<unsigned long long>> latencies(threads);
+    std::vector<unsigned long long> failures(threads, 0);
+    std::vector<std::thread> workers;
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            // Room for the widest output (99 pairs)
+            std::vector<char> outputBuffer(2 + 99 * (32 + 128), 0);
+            std::this_thread::sleep_until(start);
+
+            for (size_t i = next.fetch_add(1); i < calls.size(); i = next.fetch_add(1)) {
+                Clock::time_point callStart = Clock::now();
+                if (paced) {
+                    const Clock::time_point scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double, std::micro>(calls[i].offsetMicros / options.speed));
+                    std::this_thread::sleep_until(scheduled);
+                    callStart = scheduled;
+                }
+
+                const long result = function(calls[i].data, outputBuffer.data());
+                latencies[t].push_back(static_cast<unsigned long long>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - callStart).count()));
+                if (result != 0) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    ReplayReport report;
+    report.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (int t = 0; t < threads; t++) {
+        report.latencies.insert(report.latencies.end(), latencies[t].begin(), latencies[t].end());
+        report.failed += failures[t];
+    }
+    report.calls = report.latencies.size();
+    std::sort(report.latencies.begin(), report.latencies.end());
+    return report;
+}
+
+// Print the throughput and latency percentiles of a replay
+inline void printReplayReport(const ReplayReport& report, bool paced) {
+    auto percentile = [&](double percent) {
+        if (report.latencies.empty()) {
+            return 0.0;
+        }
+        const size_t rank = static_cast<size_t>(percent / 100.0 * (report.latencies.size() - 1) + 0.5);
+        return report.latencies[rank] / 1000.0;
+    };
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Calls: " << report.calls << " (" << report.failed << " failed)" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(1)
+              << (report.elapsedSeconds > 0 ? report.calls / report.elapsedSeconds : 0.0) << " calls/s" << std::endl;
+    std::cout << std::setprecision(3);
+    std::cout << "Latency (ms): p50 " << percentile(50)
+              << ", p90 " << percentile(90)
+              << ", p99 " << percentile(99)
+              << ", p99.9 " << percentile(99.9)
+              << ", max " << percentile(100) << std::endl;
+    if (paced) {
+        std::cout << "Latency is measured from each call's scheduled start (corrected for coordinated omission)"
+                  << std::endl;
+    }
+}
+
+#endif // CAPTURE_REPLAY_H
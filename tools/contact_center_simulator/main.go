@@ -48,8 +48,9 @@ type Parameter struct {
 
 // TestCase represents a test case for the DLL
 type TestCase struct {
-	Name       string      `json:"name"`
-	Parameters []Parameter `json:"parameters"`
+	Name       string        `json:"name"`
+	Parameters []Parameter   `json:"parameters"`
+	Stress     *StressConfig `json:"stress,omitempty"` // Run as a stress test instead of a single call
 }
 
 // TestResult represents the result of a test case
@@ -260,27 +261,13 @@ func callDLL(parameters []Parameter) TestResult {
 
 	if ret != 0 {
 		// Get the error code name based on the return value
-		errorCodeName := "UNKNOWN_ERROR"
-		switch int(ret) {
-		case 1:
-			errorCodeName = "INVALID_INPUT"
-		case 2:
-			errorCodeName = "TOO_MANY_PARAMETERS"
-		case 3:
-			errorCodeName = "CURL_INIT_FAILED"
-		case 4:
-			errorCodeName = "CURL_REQUEST_FAILED"
-		case 5:
-			errorCodeName = "HTTP_ERROR"
-		case 6:
-			errorCodeName = "UNEXPECTED_EXCEPTION"
-		}
+		codeName := errorCodeName(int(ret))
 
 		// Get detailed error message from DLL if available
 		dllErrorMessage := getLastError()
 
 		// Construct error details
-		errorDetails = fmt.Sprintf("DLL function returned error code: %d (%s)", int(ret), errorCodeName)
+		errorDetails = fmt.Sprintf("DLL function returned error code: %d (%s)", int(ret), codeName)
 
 		// Add detailed error message if available
 		if dllErrorMessage != "Unknown error" && dllErrorMessage != "Error details not available (GetLastErrorMessage function not found in DLL)" {
@@ -438,6 +425,25 @@ func callDLL(parameters []Parameter) TestResult {
 	return result
 }
 
+// errorCodeName returns the name of a DLL return code
+func errorCodeName(code int) string {
+	switch code {
+	case 1:
+		return "INVALID_INPUT"
+	case 2:
+		return "TOO_MANY_PARAMETERS"
+	case 3:
+		return "CURL_INIT_FAILED"
+	case 4:
+		return "CURL_REQUEST_FAILED"
+	case 5:
+		return "HTTP_ERROR"
+	case 6:
+		return "UNEXPECTED_EXCEPTION"
+	}
+	return "UNKNOWN_ERROR"
+}
+
 // formatBufferForDisplay formats a buffer for display
 func formatBufferForDisplay(buffer []byte) string {
 	// Format header
@@ -723,6 +729,44 @@ func handleRoot(w http.ResponseWriter, r *http.Request) {
         .debug-button:hover {
             background-color: #e68a00;
         }
+        .stress-tools {
+            margin-top: 30px;
+            padding: 15px;
+            background-color: #f5f5f5;
+            border-radius: 5px;
+            border-left: 4px solid #673ab7;
+        }
+        .stress-tools h2 {
+            color: #673ab7;
+            margin-top: 0;
+        }
+        .stress-settings {
+            display: flex;
+            gap: 15px;
+        }
+        .stress-settings .form-group {
+            flex: 1;
+        }
+        .stress-settings select {
+            width: 100%;
+            padding: 8px;
+        }
+        .stress-button {
+            margin-right: 10px;
+            background-color: #673ab7;
+        }
+        .stress-button:hover {
+            background-color: #512da8;
+        }
+        .stress-stats {
+            border-collapse: collapse;
+            margin: 10px 0;
+        }
+        .stress-stats td, .stress-stats th {
+            border: 1px solid #ccc;
+            padding: 4px 10px;
+            text-align: left;
+        }
     </style>
 </head>
 <body>
@@ -766,6 +810,36 @@ func handleRoot(w http.ResponseWriter, r *http.Request) {
             <h2>Test Result</h2>
             <div id="resultContent"></div>
         </div>
+
+        <div class="stress-tools">
+            <h2>Stress Test</h2>
+            <p>Calls the DLL from many threads at once, without per-call logging, and shows live throughput, errors and latency.</p>
+            <div class="stress-settings">
+                <div class="form-group">
+                    <label for="stressThreads">Threads:</label>
+                    <input type="text" id="stressThreads" value="32">
+                </div>
+                <div class="form-group">
+                    <label for="stressRate">Target rate (calls/s, 0 = as fast as possible):</label>
+                    <input type="text" id="stressRate" value="0">
+                </div>
+                <div class="form-group">
+                    <label for="stressDuration">Duration (seconds):</label>
+                    <input type="text" id="stressDuration" value="30">
+                </div>
+                <div class="form-group">
+                    <label for="stressSource">Parameters:</label>
+                    <select id="stressSource">
+                        <option value="current">Current parameters</option>
+                        <option value="generated">Generated from the current parameters</option>
+                        <option value="recorded">Recorded single tests</option>
+                    </select>
+                </div>
+            </div>
+            <button onclick="startStress()" class="stress-button">Start Stress Test</button>
+            <button onclick="stopStress()" class="stress-button">Stop</button>
+            <div id="stressResult"></div>
+        </div>
     </div>
 
     <script>
@@ -983,12 +1057,11 @@ func handleRoot(w http.ResponseWriter, r *http.Request) {
             });
         }
 
-        function runTest() {
-            const testName = document.getElementById('testName').value || 'Unnamed Test';
+        // Collect the parameters from the form
+        function collectParameters() {
             const parametersList = document.getElementById('parametersList');
             const parameters = [];
 
-            // Collect parameters
             for (let i = 0; i < parametersList.children.length; i++) {
                 const paramDiv = parametersList.children[i];
                 const keyInput = paramDiv.children[0];
@@ -1001,6 +1074,14 @@ func handleRoot(w http.ResponseWriter, r *http.Request) {
                     });
                 }
             }
+            return parameters;
+        }
+
+        function runTest() {
+            const testName = document.getElementById('testName').value || 'Unnamed Test';
+
+            // Collect parameters
+            const parameters = collectParameters();
 
             // Create test case
             const testCase = {
@@ -1080,6 +1161,106 @@ func handleRoot(w http.ResponseWriter, r *http.Request) {
                 alert('An error occurred: ' + error.message);
             });
         }
+
+        // Stress test
+        let stressTimer = null;
+
+        function escapeHtml(text) {
+            const div = document.createElement('div');
+            div.textContent = text;
+            return div.innerHTML;
+        }
+
+        function startStress() {
+            const testCase = {
+                name: document.getElementById('testName').value || 'Stress Test',
+                parameters: collectParameters(),
+                stress: {
+                    threads: parseInt(document.getElementById('stressThreads').value, 10) || 1,
+                    rate: parseFloat(document.getElementById('stressRate').value) || 0,
+                    durationSeconds: parseInt(document.getElementById('stressDuration').value, 10) || 1,
+                    source: document.getElementById('stressSource').value
+                }
+            };
+
+            fetch('/run-test', {
+                method: 'POST',
+                headers: {
+                    'Content-Type': 'application/json'
+                },
+                body: JSON.stringify(testCase)
+            })
+            .then(response => {
+                if (!response.ok) {
+                    return response.text().then(text => { throw new Error(text); });
+                }
+                return response.json();
+            })
+            .then(status => {
+                renderStress(status);
+                clearInterval(stressTimer);
+                stressTimer = setInterval(pollStress, 500);
+            })
+            .catch(error => {
+                document.getElementById('stressResult').innerHTML =
+                    '<p class="error">Could not start the stress test: ' + escapeHtml(error.message) + '</p>';
+            });
+        }
+
+        function stopStress() {
+            fetch('/stress/stop', { method: 'POST' }).then(pollStress);
+        }
+
+        function pollStress() {
+            fetch('/stress/status')
+            .then(response => response.json())
+            .then(status => {
+                renderStress(status);
+                if (!status.running) {
+                    clearInterval(stressTimer);
+                    stressTimer = null;
+                }
+            })
+            .catch(error => console.error('Error:', error));
+        }
+
+        function renderStress(status) {
+            const ms = value => value.toFixed(3) + ' ms';
+            let html = '<p class="' + (status.running ? 'success' : '') + '">' +
+                (status.running ? 'Running' : 'Finished') + ': ' + status.elapsedSeconds.toFixed(1) + ' of ' +
+                status.durationSeconds + ' s, ' + status.threads + ' threads, ' +
+                (status.targetRate > 0 ? 'target ' + status.targetRate + ' calls/s' : 'closed loop') + ', ' +
+                status.parameterSets + ' parameter set(s)</p>';
+
+            html += '<table class="stress-stats">';
+            html += '<tr><th>Calls</th><td>' + status.calls + '</td>';
+            html += '<th>Throughput now</th><td>' + status.currentThroughput.toFixed(1) + ' calls/s</td></tr>';
+            html += '<tr><th>Successes</th><td class="success">' + status.successes + '</td>';
+            html += '<th>Throughput overall</th><td>' + status.throughput.toFixed(1) + ' calls/s</td></tr>';
+            html += '<tr><th>Failures</th><td class="' + (status.failures > 0 ? 'error' : '') + '">' + status.failures + '</td>';
+            html += '<th>Mean latency</th><td>' + ms(status.latency.mean) + '</td></tr>';
+            html += '</table>';
+
+            html += '<table class="stress-stats"><tr><th>p50</th><th>p90</th><th>p99</th><th>p99.9</th><th>max</th></tr>';
+            html += '<tr><td>' + ms(status.latency.p50) + '</td><td>' + ms(status.latency.p90) + '</td><td>' +
+                ms(status.latency.p99) + '</td><td>' + ms(status.latency.p999) + '</td><td>' +
+                ms(status.latency.max) + '</td></tr></table>';
+            if (status.targetRate > 0) {
+                html += '<p>Latency is measured from each call\'s scheduled start (corrected for coordinated omission).</p>';
+            }
+
+            if (status.errors.length > 0) {
+                html += '<h3>Errors</h3>';
+                html += '<table class="stress-stats"><tr><th>Count</th><th>Return code</th><th>Message</th></tr>';
+                for (const error of status.errors) {
+                    html += '<tr><td>' + error.count + '</td><td>' + error.returnCode + ' (' + error.name + ')</td><td>' +
+                        escapeHtml(error.message) + '</td></tr>';
+                }
+                html += '</table>';
+            }
+
+            document.getElementById('stressResult').innerHTML = html;
+        }
     </script>
 </body>
 </html>
@@ -1104,14 +1285,59 @@ func handleRunTest(w http.ResponseWriter, r *http.Request) {
 		return
 	}
 
-	// Call DLL
+	// Start a stress run in the background and return its first status
+	if testCase.Stress != nil {
+		run, err := startStress(testCase.Parameters, *testCase.Stress)
+		if err != nil {
+			http.Error(w, err.Error(), http.StatusConflict)
+			return
+		}
+		w.Header().Set("Content-Type", "application/json")
+		json.NewEncoder(w).Encode(run.status())
+		return
+	}
+
+	// Call DLL, keeping the parameters for stress runs that replay recorded tests
 	result := callDLL(testCase.Parameters)
+	recordParameters(testCase.Parameters)
 
 	// Return result as JSON
 	w.Header().Set("Content-Type", "application/json")
 	json.NewEncoder(w).Encode(result)
 }
 
+// handleStressStatus returns the live status of the current or last stress run
+func handleStressStatus(w http.ResponseWriter, r *http.Request) {
+	// Only accept GET requests
+	if r.Method != http.MethodGet {
+		http.Error(w, "Method not allowed", http.StatusMethodNotAllowed)
+		return
+	}
+
+	stressMutex.Lock()
+	run := currentStress
+	stressMutex.Unlock()
+	if run == nil {
+		http.Error(w, "No stress run yet", http.StatusNotFound)
+		return
+	}
+
+	w.Header().Set("Content-Type", "application/json")
+	json.NewEncoder(w).Encode(run.status())
+}
+
+// handleStressStop ends the current stress run early
+func handleStressStop(w http.ResponseWriter, r *http.Request) {
+	// Only accept POST requests
+	if r.Method != http.MethodPost {
+		http.Error(w, "Method not allowed", http.StatusMethodNotAllowed)
+		return
+	}
+
+	stopStress()
+	w.WriteHeader(http.StatusNoContent)
+}
+
 // handleDllConfig handles requests to get DLL configuration
 func handleDllConfig(w http.ResponseWriter, r *http.Request) {
 	// Only accept GET requests
@@ -1282,11 +1508,14 @@ func main() {
 	http.HandleFunc("/run-test", handleRunTest)
 	http.HandleFunc("/debug/dll-config", handleDllConfig)
 	http.HandleFunc("/debug/server-connection", handleServerConnection)
+	http.HandleFunc("/stress/status", handleStressStatus)
+	http.HandleFunc("/stress/stop", handleStressStop)
 
 	// Log available debugging tools
 	log.Printf("Debugging tools available at:")
 	log.Printf("  - /debug/dll-config - View DLL configuration")
 	log.Printf("  - /debug/server-connection - Test server connection")
+	log.Printf("  - /stress/status - Live status of the stress run")
 
 	// Start server
 	addr := fmt.Sprintf(":%d", *port)
@@ -0,0 +1,469 @@
+package main
+
+import (
+	"fmt"
+	"log"
+	"math"
+	"math/bits"
+	"math/rand"
+	"runtime"
+	"sort"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+// Stress mode: many OS threads call the DLL at once, the way OpenScape's routing threads
+// do, while the web page shows throughput, errors and latency as the run goes on.
+
+// Limits for stress runs
+const (
+	MaxStressThreads   = 1024
+	MaxStressSeconds   = 3600
+	MaxRecordedSets    = 1000
+	GeneratedSetCount  = 256
+	MaxStressErrorKeys = 50
+	LatencyBuckets     = 200
+)
+
+// StressConfig describes a stress run, sent as the "stress" field of a /run-test request
+type StressConfig struct {
+	Threads         int           `json:"threads"`
+	Rate            float64       `json:"rate"` // Total calls per second; 0 runs closed-loop
+	DurationSeconds int           `json:"durationSeconds"`
+	Source          string        `json:"source"`        // "current", "recorded" or "generated"
+	ParameterSets   [][]Parameter `json:"parameterSets"` // Replayed instead of the source when given
+}
+
+// StressError counts the failures with one return code and error message
+type StressError struct {
+	ReturnCode int    `json:"returnCode"`
+	Name       string `json:"name"`
+	Message    string `json:"message"`
+	Count      uint64 `json:"count"`
+}
+
+// StressLatency holds latency percentiles in milliseconds
+type StressLatency struct {
+	Mean float64 `json:"mean"`
+	P50  float64 `json:"p50"`
+	P90  float64 `json:"p90"`
+	P99  float64 `json:"p99"`
+	P999 float64 `json:"p999"`
+	Max  float64 `json:"max"`
+}
+
+// StressStatus is the state of the current or last stress run
+type StressStatus struct {
+	Running           bool          `json:"running"`
+	Threads           int           `json:"threads"`
+	TargetRate        float64       `json:"targetRate"`
+	DurationSeconds   int           `json:"durationSeconds"`
+	ParameterSets     int           `json:"parameterSets"`
+	ElapsedSeconds    float64       `json:"elapsedSeconds"`
+	Calls             uint64        `json:"calls"`
+	Successes         uint64        `json:"successes"`
+	Failures          uint64        `json:"failures"`
+	Throughput        float64       `json:"throughput"`        // Calls per second over the whole run
+	CurrentThroughput float64       `json:"currentThroughput"` // Calls per second since the previous status
+	Latency           StressLatency `json:"latency"`
+	Errors            []StressError `json:"errors"`
+}
+
+// latencyHistogram counts latencies in microseconds in log-linear buckets (8 per power
+// of two, the same layout as GetDllStats and the test client's --bench mode). Each
+// worker owns one and updates it with atomics, so the status can be read during the run.
+type latencyHistogram struct {
+	buckets [LatencyBuckets]atomic.Uint64
+	count   atomic.Uint64
+	sum     atomic.Uint64
+	max     atomic.Uint64
+}
+
+func latencyBucket(micros uint64) int {
+	if micros < 8 {
+		return int(micros)
+	}
+	msb := bits.Len64(micros) - 1
+	index := (msb-2)*8 + int(micros>>(msb-3)) - 8
+	if index >= LatencyBuckets {
+		return LatencyBuckets - 1
+	}
+	return index
+}
+
+func latencyBucketLowerBound(index int) uint64 {
+	if index < 8 {
+		return uint64(index)
+	}
+	return uint64(8+index%8) << (index/8 - 1)
+}
+
+func (h *latencyHistogram) record(micros uint64) {
+	h.buckets[latencyBucket(micros)].Add(1)
+	h.count.Add(1)
+	h.sum.Add(micros)
+	for {
+		current := h.max.Load()
+		if micros <= current || h.max.CompareAndSwap(current, micros) {
+			break
+		}
+	}
+}
+
+// histogramSnapshot is the sum of the workers' histograms at one point in time
+type histogramSnapshot struct {
+	buckets [LatencyBuckets]uint64
+	count   uint64
+	sum     uint64
+	max     uint64
+}
+
+func (s *histogramSnapshot) add(h *latencyHistogram) {
+	for i := range s.buckets {
+		s.buckets[i] += h.buckets[i].Load()
+	}
+	s.count += h.count.Load()
+	s.sum += h.sum.Load()
+	if m := h.max.Load(); m > s.max {
+		s.max = m
+	}
+}
+
+// percentile returns the upper bound of the bucket holding the given percentile (0-100)
+func (s *histogramSnapshot) percentile(percent float64) uint64 {
+	if s.count == 0 {
+		return 0
+	}
+	rank := uint64(math.Ceil(percent / 100 * float64(s.count)))
+	var seen uint64
+	for i, n := range s.buckets {
+		seen += n
+		if seen >= rank && n > 0 {
+			if i+1 < LatencyBuckets && latencyBucketLowerBound(i+1)-1 < s.max {
+				return latencyBucketLowerBound(i+1) - 1
+			}
+			return s.max
+		}
+	}
+	return s.max
+}
+
+// stressRun is one stress run and its live counters
+type stressRun struct {
+	config     StressConfig
+	inputs     [][]byte
+	start      time.Time
+	end        time.Time
+	histograms []*latencyHistogram
+	failures   atomic.Uint64
+	stopped    atomic.Bool
+	running    atomic.Bool
+
+	mutex       sync.Mutex
+	finished    time.Time // When the workers were done
+	errors      map[string]*StressError
+	lastCalls   uint64
+	lastPoll    time.Time
+	lastCurrent float64
+}
+
+var (
+	stressMutex   sync.Mutex
+	currentStress *stressRun
+
+	recordedMutex sync.Mutex
+	recordedSets  [][]Parameter
+)
+
+// recordParameters keeps the parameters of a single test for replay by stress runs
+func recordParameters(parameters []Parameter) {
+	if len(parameters) == 0 {
+		return
+	}
+	recordedMutex.Lock()
+	defer recordedMutex.Unlock()
+	if len(recordedSets) >= MaxRecordedSets {
+		recordedSets = recordedSets[1:]
+	}
+	recordedSets = append(recordedSets, append([]Parameter(nil), parameters...))
+}
+
+// generateParameterSets makes variations of parameters: every all-digit value (phone
+// numbers, IDs) is replaced by random digits of the same length, so the calls are not
+// all identical and caches or request coalescing in the DLL do not hide the backend
+func generateParameterSets(parameters []Parameter, count int) [][]Parameter {
+	random := rand.New(rand.NewSource(time.Now().UnixNano()))
+	sets := make([][]Parameter, count)
+	for i := range sets {
+		set := make([]Parameter, len(parameters))
+		for j, param := range parameters {
+			set[j] = param
+			if isDigits(param.Value) {
+				digits := []byte(param.Value)
+				for k := range digits {
+					digits[k] = byte('0' + random.Intn(10))
+				}
+				set[j].Value = string(digits)
+			}
+		}
+		sets[i] = set
+	}
+	return sets
+}
+
+func isDigits(value string) bool {
+	if value == "" {
+		return false
+	}
+	for i := 0; i < len(value); i++ {
+		if value[i] < '0' || value[i] > '9' {
+			return false
+		}
+	}
+	return true
+}
+
+// stressParameterSets picks the parameter sets a run replays
+func stressParameterSets(parameters []Parameter, config StressConfig) ([][]Parameter, error) {
+	if len(config.ParameterSets) > 0 {
+		return config.ParameterSets, nil
+	}
+	switch config.Source {
+	case "", "current":
+		if len(parameters) == 0 {
+			return nil, fmt.Errorf("no parameters to send")
+		}
+		return [][]Parameter{parameters}, nil
+	case "recorded":
+		recordedMutex.Lock()
+		defer recordedMutex.Unlock()
+		if len(recordedSets) == 0 {
+			return nil, fmt.Errorf("no recorded tests yet; run some single tests first")
+		}
+		return append([][]Parameter(nil), recordedSets...), nil
+	case "generated":
+		if len(parameters) == 0 {
+			return nil, fmt.Errorf("no parameters to generate from")
+		}
+		return generateParameterSets(parameters, GeneratedSetCount), nil
+	}
+	return nil, fmt.Errorf("unknown source %q", config.Source)
+}
+
+// startStress starts a stress run in the background unless one is already running
+func startStress(parameters []Parameter, config StressConfig) (*stressRun, error) {
+	if config.Threads < 1 || config.Threads > MaxStressThreads {
+		return nil, fmt.Errorf("threads must be between 1 and %d", MaxStressThreads)
+	}
+	if config.DurationSeconds < 1 || config.DurationSeconds > MaxStressSeconds {
+		return nil, fmt.Errorf("duration must be between 1 and %d seconds", MaxStressSeconds)
+	}
+	if config.Rate < 0 {
+		return nil, fmt.Errorf("rate cannot be negative")
+	}
+	sets, err := stressParameterSets(parameters, config)
+	if err != nil {
+		return nil, err
+	}
+
+	stressMutex.Lock()
+	defer stressMutex.Unlock()
+	if currentStress != nil && currentStress.running.Load() {
+		return nil, fmt.Errorf("a stress run is already in progress")
+	}
+
+	// Build every input buffer up front so the workers only call the DLL
+	run := &stressRun{
+		config:     config,
+		inputs:     make([][]byte, len(sets)),
+		histograms: make([]*latencyHistogram, config.Threads),
+		errors:     make(map[string]*StressError),
+	}
+	for i, set := range sets {
+		run.inputs[i] = createInputBuffer(set)
+	}
+	for t := range run.histograms {
+		run.histograms[t] = &latencyHistogram{}
+	}
+	run.start = time.Now().Add(100 * time.Millisecond)
+	run.end = run.start.Add(time.Duration(config.DurationSeconds) * time.Second)
+	run.lastPoll = run.start
+	run.running.Store(true)
+	currentStress = run
+
+	log.Printf("Stress run: %d threads, %d s, rate %.1f calls/s (0 = closed loop), %d parameter sets; per-call logging is off",
+		config.Threads, config.DurationSeconds, config.Rate, len(sets))
+
+	var workers sync.WaitGroup
+	for t := 0; t < config.Threads; t++ {
+		workers.Add(1)
+		go func(t int) {
+			defer workers.Done()
+			run.worker(t)
+		}(t)
+	}
+	go func() {
+		workers.Wait()
+		run.mutex.Lock()
+		run.finished = time.Now()
+		run.mutex.Unlock()
+		run.running.Store(false)
+		status := run.status()
+		log.Printf("Stress run finished: %d calls, %d failed, %.1f calls/s, p99 %.3f ms",
+			status.Calls, status.Failures, status.Throughput, status.Latency.P99)
+	}()
+	return run, nil
+}
+
+// stopStress ends the current stress run early
+func stopStress() {
+	stressMutex.Lock()
+	defer stressMutex.Unlock()
+	if currentStress != nil {
+		currentStress.stopped.Store(true)
+	}
+}
+
+// callDLLRaw calls the DLL function without any logging or result analysis
+func callDLLRaw(input []byte, output []byte) int {
+	ret, _, _ := syscall.Syscall(dllFunction, 2,
+		uintptr(unsafe.Pointer(&input[0])),
+		uintptr(unsafe.Pointer(&output[0])),
+		0)
+	return int(ret)
+}
+
+// worker calls the DLL until the run ends. It stays on one OS thread, so the DLL sees a
+// fixed set of calling threads (its per-thread state and GetLastErrorMessage depend on it).
+//
+// With a target rate each worker follows a fixed schedule, and latency is measured from
+// the time a call was scheduled to start, so a stall shows up in the percentiles for
+// every call it delayed (no coordinated omission).
+func (run *stressRun) worker(t int) {
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+
+	threads := run.config.Threads
+	paced := run.config.Rate > 0
+	var interval time.Duration
+	if paced {
+		interval = time.Duration(float64(threads) / run.config.Rate * float64(time.Second))
+	}
+	histogram := run.histograms[t]
+	output := make([]byte, HeaderSize+PairSize)
+
+	// Stagger the paced workers so their calls are spread over the interval
+	scheduled := run.start.Add(interval * time.Duration(t) / time.Duration(threads))
+	time.Sleep(time.Until(run.start))
+
+	for i := t; !run.stopped.Load(); i++ {
+		if paced {
+			if !scheduled.Before(run.end) {
+				break
+			}
+			time.Sleep(time.Until(scheduled))
+		}
+		callStart := scheduled
+		if !paced {
+			callStart = time.Now()
+			if !callStart.Before(run.end) {
+				break
+			}
+		}
+
+		ret := callDLLRaw(run.inputs[i%len(run.inputs)], output)
+		histogram.record(uint64(time.Since(callStart).Microseconds()))
+		if ret != 0 {
+			run.failures.Add(1)
+			run.recordError(ret, getLastError())
+		}
+		scheduled = scheduled.Add(interval)
+	}
+}
+
+// recordError counts a failed call by return code and message
+func (run *stressRun) recordError(code int, message string) {
+	run.mutex.Lock()
+	defer run.mutex.Unlock()
+	key := fmt.Sprintf("%d:%s", code, message)
+	entry, ok := run.errors[key]
+	if !ok {
+		if len(run.errors) >= MaxStressErrorKeys {
+			key = fmt.Sprintf("%d:", code)
+			message = "(other messages)"
+			entry, ok = run.errors[key]
+		}
+		if !ok {
+			entry = &StressError{ReturnCode: code, Name: errorCodeName(code), Message: message}
+			run.errors[key] = entry
+		}
+	}
+	entry.Count++
+}
+
+// status takes a snapshot of the run's counters
+func (run *stressRun) status() StressStatus {
+	var snapshot histogramSnapshot
+	for _, h := range run.histograms {
+		snapshot.add(h)
+	}
+	failures := run.failures.Load()
+	if failures > snapshot.count {
+		failures = snapshot.count
+	}
+
+	run.mutex.Lock()
+	defer run.mutex.Unlock()
+
+	now := time.Now()
+	if !run.finished.IsZero() {
+		now = run.finished
+	}
+	elapsed := now.Sub(run.start).Seconds()
+	if elapsed < 0 {
+		elapsed = 0
+	}
+
+	// Throughput since the previous status, kept for polls that come too close together
+	if since := now.Sub(run.lastPoll).Seconds(); since >= 0.25 {
+		run.lastCurrent = float64(snapshot.count-run.lastCalls) / since
+		run.lastCalls = snapshot.count
+		run.lastPoll = now
+	}
+
+	millis := func(micros uint64) float64 { return float64(micros) / 1000 }
+	status := StressStatus{
+		Running:           run.running.Load(),
+		Threads:           run.config.Threads,
+		TargetRate:        run.config.Rate,
+		DurationSeconds:   run.config.DurationSeconds,
+		ParameterSets:     len(run.inputs),
+		ElapsedSeconds:    elapsed,
+		Calls:             snapshot.count,
+		Successes:         snapshot.count - failures,
+		Failures:          failures,
+		CurrentThroughput: run.lastCurrent,
+		Latency: StressLatency{
+			P50:  millis(snapshot.percentile(50)),
+			P90:  millis(snapshot.percentile(90)),
+			P99:  millis(snapshot.percentile(99)),
+			P999: millis(snapshot.percentile(99.9)),
+			Max:  millis(snapshot.max),
+		},
+		Errors: make([]StressError, 0, len(run.errors)),
+	}
+	if elapsed > 0 {
+		status.Throughput = float64(snapshot.count) / elapsed
+	}
+	if snapshot.count > 0 {
+		status.Latency.Mean = millis(snapshot.sum) / float64(snapshot.count)
+	}
+	for _, entry := range run.errors {
+		status.Errors = append(status.Errors, *entry)
+	}
+	sort.Slice(status.Errors, func(i, j int) bool { return status.Errors[i].Count > status.Errors[j].Count })
+	return status
+}
@@ -0,0 +1,242 @@
+// Microbenchmarks for the CPU-side hot path of CustomDLL.
+//
+// The DLL source is compiled into this executable so its internal functions can be
+// timed directly, without a live backend: curl delivering a response is simulated by
+// feeding a canned body through WriteCallback (the mocked transport). Each benchmark runs
+// with 5, 20 and 99 input pairs (99 is the most the 2-digit count header can describe).
+//
+// Usage: CustomDLLBench [--filter text] [--min-time seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/custom.cpp"
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+// Keep the optimizer from discarding a benchmarked result
+const void* volatile g_sink = nullptr;
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+    g_sink = &value;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+struct BenchSettings {
+    std::string filter;
+    double minTimeSeconds = 0.5;
+};
+
+// Run body in growing batches until minTime has elapsed and print the time per call
+void RunBenchmark(const BenchSettings& settings, const std::string& name, const std::function<void()>& body) {
+    if (!settings.filter.empty() && name.find(settings.filter) == std::string::npos) {
+        return;
+    }
+
+    // Warm up caches and thread-local buffers
+    for (int i = 0; i < 100; i++) {
+        body();
+    }
+
+    unsigned long long iterations = 0;
+    unsigned long long batch = 16;
+    const auto minTime = std::chrono::duration<double>(settings.minTimeSeconds);
+    const BenchClock::time_point start = BenchClock::now();
+    BenchClock::duration elapsed{};
+    while (elapsed < minTime) {
+        for (unsigned long long i = 0; i < batch; i++) {
+            body();
+        }
+        iterations += batch;
+        batch = std::min<unsigned long long>(batch * 2, 1 << 20);
+        elapsed = BenchClock::now() - start;
+    }
+
+    const double nanosPerCall = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    printf("%-40s %12.1f ns %14llu iterations\n", name.c_str(), nanosPerCall, iterations);
+}
+
+// Input buffer with count pairs shaped like real routing requests
+std::vector<char> MakeInput(unsigned int count) {
+    std::vector<char> buffer(HEADER_SIZE + count * PAIR_SIZE, 0);
+    WriteOutputCount(buffer.data(), count);
+
+    auto setPair = [&](unsigned int index, const std::string& key, const std::string& value) {
+        char* pair = buffer.data() + HEADER_SIZE + index * PAIR_SIZE;
+        memcpy(pair, key.data(), std::min<size_t>(key.size(), KEY_SIZE - 1));
+        memcpy(pair + KEY_SIZE, value.data(), std::min<size_t>(value.size(), VALUE_SIZE - 1));
+    };
+
+    const std::string fixed[][2] = {
+        {"Endpoint", "procesareDate_1"},
+        {"CFResp", "yes"},
+        {"Tel", "0744516456"},
+        {"CIF", "1234KTE"},
+        {"CID", "193691036401673"},
+    };
+    for (unsigned int i = 0; i < count; i++) {
+        if (i < 5) {
+            setPair(i, fixed[i][0], fixed[i][1]);
+        } else {
+            // Mix plain values with ones that need percent-encoding
+            setPair(i, "Field" + std::to_string(i),
+                    i % 3 == 0 ? "Str. Exemplu nr. " + std::to_string(i) + " & bl. A/2"
+                               : "value" + std::to_string(i * 7919));
+        }
+    }
+    return buffer;
+}
+
+// Write a config.ini like the shipped one and return its path
+std::string WriteBenchConfig() {
+    const std::string path = (std::filesystem::temp_directory_path() / "custom_dll_bench_config.ini").string();
+    std::ofstream file(path, std::ios::trunc);
+    file << "[api]\n"
+            "base_url=http://127.0.0.1:8080/api/index.php\n"
+            "timeout=4\n"
+            "connect_timeout=2\n"
+            "verify_ssl=0\n"
+            "max_idle_connections=2\n"
+            "reload_interval=5\n"
+            "\n"
+            "[dns]\n"
+            "shared_cache=1\n"
+            "cache_timeout=60\n"
+            "\n"
+            "[dns_resolve]\n"
+            "testing-dll:443=192.168.102.55\n"
+            "\n"
+            "[cache]\n"
+            "enabled=1\n"
+            "max_memory_kb=1024\n"
+            "\n"
+            "[cache_ttl]\n"
+            "getInfo=10\n";
+    return path;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchSettings settings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            settings.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            settings.minTimeSeconds = std::stod(argv[++i]);
+        }
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    const std::string urlPrefix = "http://127.0.0.1:8080/api/index.php?";
+    const std::string cannedResponse =
+        "Success! Processed request for:\r\nTel: 0744516456\r\nCIF: 1234KTE\r\nCID: 193691036401673\r\n"
+        "Timestamp: 2024-01-01 12:00:00\r\n";
+
+    for (unsigned int pairs : {5u, 20u, 99u}) {
+        const std::vector<char> input = MakeInput(pairs);
+        const std::string suffix = "/" + std::to_string(pairs);
+
+        ParameterTable<MAX_PARAMETERS> parsed;
+        parsed.Parse(input.data(), pairs);
+
+        // Input-buffer parsing into the flat parameter table
+        RunBenchmark(settings, "ParseInput" + suffix, [&] {
+            ParameterTable<MAX_PARAMETERS> parameters;
+            parameters.Parse(input.data(), pairs);
+            DoNotOptimize(parameters);
+        });
+
+        // Percent-encoding every value
+        std::string encoded;
+        RunBenchmark(settings, "UrlEncode" + suffix, [&] {
+            encoded.clear();
+            for (const Parameter& parameter : parsed) {
+                AppendUrlEncoded(encoded, parameter.value);
+            }
+            DoNotOptimize(encoded);
+        });
+
+        // Full URL assembly into a reused buffer
+        std::string url;
+        RunBenchmark(settings, "BuildRequestUrl" + suffix, [&] {
+            BuildRequestUrl(url, urlPrefix, parsed);
+            DoNotOptimize(url);
+        });
+
+        // One call without the network: parse, build the URL, receive the canned response
+        // in two chunks as curl would, and pack the output buffer
+        std::vector<char> output(HEADER_SIZE + PAIR_SIZE, 0);
+        RunBenchmark(settings, "MockedCall" + suffix, [&] {
+            ParameterTable<MAX_PARAMETERS> parameters;
+            parameters.Parse(input.data(), pairs);
+            BuildRequestUrl(url, urlPrefix, parameters);
+
+            std::string responseData;
+            responseData.reserve(1024);
+            const size_t half = cannedResponse.size() / 2;
+            WriteCallback(const_cast<char*>(cannedResponse.data()), 1, half, &responseData);
+            WriteCallback(const_cast<char*>(cannedResponse.data()) + half, 1, cannedResponse.size() - half,
+                          &responseData);
+
+            WriteOutputCount(output.data(), 1);
+            WriteOutputPair(output.data(), 0, "CFResp", FieldView(responseData.data(), responseData.size()));
+            DoNotOptimize(output);
+        });
+    }
+
+    // Response body accumulation as curl delivers it (16 KB in 1 KB chunks)
+    const std::string chunk(1024, 'x');
+    RunBenchmark(settings, "WriteCallback/16x1KB", [&] {
+        std::string responseData;
+        responseData.reserve(1024);
+        for (int i = 0; i < 16; i++) {
+            WriteCallback(const_cast<char*>(chunk.data()), 1, chunk.size(), &responseData);
+        }
+        DoNotOptimize(responseData);
+    });
+
+    // Streaming extraction of one JSON field from a 4 KB document that arrives in 1 KB chunks
+    const std::string document = "{\"status\":\"ok\",\"details\":{\"queue\":\"support\",\"agents\":[1,2,3]},\"note\":\""
+        + std::string(4000, 'n') + "\",\"result\":\"Agent 42 is available\"}";
+    const std::string field = "result";
+    RunBenchmark(settings, "ExtractJsonField/4KB", [&] {
+        ResponseExtractor extractor;
+        extractor.Reset(ResponseExtractor::Format::Json, &field, 1, 1 << 20);
+        for (size_t offset = 0; offset < document.size(); offset += 1024) {
+            extractor.Feed(document.data() + offset, std::min<size_t>(1024, document.size() - offset));
+        }
+        DoNotOptimize(extractor);
+    });
+
+    // Output packing of a long response into the CFResp slot
+    std::vector<char> output(HEADER_SIZE + PAIR_SIZE, 0);
+    RunBenchmark(settings, "PackOutput", [&] {
+        WriteOutputCount(output.data(), 1);
+        WriteOutputPair(output.data(), 0, "CFResp", cannedResponse);
+        DoNotOptimize(output);
+    });
+
+    // Reading and parsing config.ini (what a reload costs)
+    const std::string configPath = WriteBenchConfig();
+    RunBenchmark(settings, "ReadConfig", [&] {
+        ConfigSettings config = ReadConfig(configPath);
+        DoNotOptimize(config);
+    });
+    std::remove(configPath.c_str());
+
+    curl_global_cleanup();
+    return 0;
+}
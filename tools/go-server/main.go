@@ -89,10 +89,16 @@ func main() {
 	mainLogger.Printf("Logging error responses to %s", errorLogFilePath)
 	mainLogger.Printf("Logging DLL data to %s", dataLogFilePath)
 
+	// Set up the fault profile for the API endpoints (see profile.go)
+	if err := setupProfile(); err != nil {
+		log.Fatalf("Invalid fault profile: %v", err)
+	}
+
  // Register handlers
  http.HandleFunc("/", handleRoot)
  http.HandleFunc("/api/index.php", handleAPI)
  http.HandleFunc("/testoscc.php", handleAPI) // Add handler for testoscc.php endpoint
+ http.HandleFunc("/profile", handleProfile)   // View or change the fault profile
 
 	// Start server
 	addr := fmt.Sprintf(":%d", *port)
@@ -212,6 +218,15 @@ func handleAPI(w http.ResponseWriter, r *http.Request) {
 		dataLogger.Printf("REQUEST DATA: %s", string(jsonData))
 	}
 
+	// Apply the fault profile: delay, fail or reset the request, or hold the response
+	// back to pad or drip it
+	w, finishProfile, handled := applyProfile(w, r)
+	if handled {
+		mainLogger.Printf("=== END CURL REQUEST ===")
+		return
+	}
+	defer finishProfile()
+
 	// Check for required parameters - case-insensitive approach
 	endpoint := getCaseInsensitiveFormValue(r, "endpoint")
 
@@ -0,0 +1,433 @@
+package main
+
+import (
+	"bytes"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"math"
+	"math/rand"
+	"net"
+	"net/http"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Fault and latency profiles for the API endpoints.
+//
+// A profile makes the server slow, flaky or heavy in a reproducible way, so the DLL's
+// timeouts, circuit breaker and response streaming can be tested against it: added
+// latency from a distribution, a share of 5xx responses or connection resets, bodies
+// sent a few bytes at a time, and bodies padded to a large size. The profile is chosen
+// at startup with -profile and the flags below, and can be changed while the server runs
+// through /profile.
+
+// Profile describes how API responses are degraded
+type Profile struct {
+	Name         string        `json:"name"`
+	Latency      string        `json:"latency"`      // none, fixed:D, normal:MEAN,STDDEV or longtail:MEDIAN,P99
+	ErrorRate    float64       `json:"errorRate"`    // Percent of requests answered with ErrorStatus
+	ErrorStatus  int           `json:"errorStatus"`  // Status code of injected errors
+	ResetRate    float64       `json:"resetRate"`    // Percent of connections reset without a response
+	DripInterval time.Duration `json:"dripInterval"` // Pause between chunks of the body (0 = send it at once)
+	DripChunk    int           `json:"dripChunk"`    // Bytes per chunk when dripping
+	BodySize     int           `json:"bodySize"`     // Bodies are padded to at least this many bytes (0 = as is)
+
+	latency latencyDistribution
+}
+
+// Named profiles selected with -profile; the other flags override their fields
+var profilePresets = map[string]Profile{
+	"normal": {},
+	"slow":   {Latency: "fixed:500ms"},
+	"jitter": {Latency: "normal:50ms,15ms"},
+	"tail":   {Latency: "longtail:20ms,2s"},
+	"flaky":  {Latency: "normal:50ms,15ms", ErrorRate: 10, ResetRate: 2},
+	"down":   {ErrorRate: 100},
+	"drip":   {DripInterval: 200 * time.Millisecond, DripChunk: 16},
+	"huge":   {BodySize: 1 << 20},
+}
+
+// Default values for the fields a preset leaves unset
+const (
+	DefaultErrorStatus = http.StatusServiceUnavailable
+	DefaultDripChunk   = 16
+	MaxInjectedLatency = time.Minute
+)
+
+var (
+	currentProfile atomic.Pointer[Profile]
+
+	// Seeded once so a run with the same -seed makes the same decisions in the same order
+	randomMutex sync.Mutex
+	random      = rand.New(rand.NewSource(1))
+)
+
+// latencyDistribution is the parsed form of Profile.Latency
+type latencyDistribution struct {
+	kind string        // "", "fixed", "normal" or "longtail"
+	a    time.Duration // Fixed value, mean or median
+	b    time.Duration // Standard deviation or p99
+}
+
+// parseLatency parses a latency specification such as "normal:50ms,10ms"
+func parseLatency(spec string) (latencyDistribution, error) {
+	spec = strings.TrimSpace(spec)
+	if spec == "" || spec == "none" {
+		return latencyDistribution{}, nil
+	}
+	kind, args, found := strings.Cut(spec, ":")
+	if !found {
+		return latencyDistribution{}, fmt.Errorf("invalid latency %q (use none, fixed:D, normal:MEAN,STDDEV or longtail:MEDIAN,P99)", spec)
+	}
+	values := []time.Duration{}
+	for _, arg := range strings.Split(args, ",") {
+		value, err := time.ParseDuration(strings.TrimSpace(arg))
+		if err != nil || value < 0 {
+			return latencyDistribution{}, fmt.Errorf("invalid duration %q in latency %q", arg, spec)
+		}
+		values = append(values, value)
+	}
+
+	switch kind {
+	case "fixed":
+		if len(values) == 1 {
+			return latencyDistribution{kind: kind, a: values[0]}, nil
+		}
+	case "normal":
+		if len(values) == 2 {
+			return latencyDistribution{kind: kind, a: values[0], b: values[1]}, nil
+		}
+	case "longtail":
+		if len(values) == 2 && values[0] > 0 && values[1] >= values[0] {
+			return latencyDistribution{kind: kind, a: values[0], b: values[1]}, nil
+		}
+	}
+	return latencyDistribution{}, fmt.Errorf("invalid latency %q (use none, fixed:D, normal:MEAN,STDDEV or longtail:MEDIAN,P99)", spec)
+}
+
+// sample draws one latency. The long tail is log-normal with the given median and p99.
+func (d latencyDistribution) sample(r *rand.Rand) time.Duration {
+	var value float64
+	switch d.kind {
+	case "fixed":
+		return d.a
+	case "normal":
+		value = float64(d.a) + float64(d.b)*r.NormFloat64()
+	case "longtail":
+		// z of the 99th percentile of the standard normal distribution
+		sigma := math.Log(float64(d.b)/float64(d.a)) / 2.3263
+		value = float64(d.a) * math.Exp(sigma*r.NormFloat64())
+	default:
+		return 0
+	}
+	return time.Duration(math.Max(0, math.Min(value, float64(MaxInjectedLatency))))
+}
+
+// validate fills in defaults, checks the fields and parses the latency
+func (p *Profile) validate() error {
+	if p.ErrorRate < 0 || p.ErrorRate > 100 || p.ResetRate < 0 || p.ResetRate > 100 {
+		return fmt.Errorf("error and reset rates are percentages (0-100)")
+	}
+	if p.ErrorStatus == 0 {
+		p.ErrorStatus = DefaultErrorStatus
+	}
+	if p.ErrorStatus < 100 || p.ErrorStatus > 599 {
+		return fmt.Errorf("invalid error status %d", p.ErrorStatus)
+	}
+	if p.DripChunk <= 0 {
+		p.DripChunk = DefaultDripChunk
+	}
+	if p.DripInterval < 0 || p.BodySize < 0 {
+		return fmt.Errorf("drip interval and body size cannot be negative")
+	}
+	latency, err := parseLatency(p.Latency)
+	if err != nil {
+		return err
+	}
+	p.latency = latency
+	return nil
+}
+
+// MarshalJSON shows the drip interval as a duration such as "200ms"
+func (p Profile) MarshalJSON() ([]byte, error) {
+	type plain Profile
+	return json.Marshal(struct {
+		plain
+		DripInterval string `json:"dripInterval"`
+	}{plain(p), p.DripInterval.String()})
+}
+
+// String describes the profile for the log
+func (p *Profile) String() string {
+	latency := p.Latency
+	if latency == "" {
+		latency = "none"
+	}
+	return fmt.Sprintf("%s (latency %s, errors %.1f%% as %d, resets %.1f%%, drip %d bytes every %v, body size %d)",
+		p.Name, latency, p.ErrorRate, p.ErrorStatus, p.ResetRate, p.DripChunk, p.DripInterval, p.BodySize)
+}
+
+// Profile flags, registered before flag.Parse in main
+var (
+	profileFlag      = flag.String("profile", "normal", "Fault profile: normal, slow, jitter, tail, flaky, down, drip or huge")
+	latencyFlag      = flag.String("latency", "", "Added latency: none, fixed:D, normal:MEAN,STDDEV or longtail:MEDIAN,P99")
+	errorRateFlag    = flag.Float64("error-rate", 0, "Percent of API requests answered with -error-status")
+	errorStatusFlag  = flag.Int("error-status", DefaultErrorStatus, "Status code of injected errors")
+	resetRateFlag    = flag.Float64("reset-rate", 0, "Percent of API connections reset without a response")
+	dripIntervalFlag = flag.Duration("drip-interval", 0, "Pause between chunks of a response body (0 = send at once)")
+	dripChunkFlag    = flag.Int("drip-chunk", DefaultDripChunk, "Bytes per chunk with -drip-interval")
+	bodySizeFlag     = flag.Int("body-size", 0, "Pad response bodies to at least this many bytes")
+	seedFlag         = flag.Int64("seed", 1, "Random seed for latency and faults (0 = different every run)")
+)
+
+// setupProfile builds the startup profile from -profile and the flags set on the command line
+func setupProfile() error {
+	seed := *seedFlag
+	if seed == 0 {
+		seed = time.Now().UnixNano()
+	}
+	random = rand.New(rand.NewSource(seed))
+
+	profile, ok := profilePresets[*profileFlag]
+	if !ok {
+		return fmt.Errorf("unknown profile %q", *profileFlag)
+	}
+	profile.Name = *profileFlag
+
+	flag.Visit(func(f *flag.Flag) {
+		switch f.Name {
+		case "latency":
+			profile.Latency = *latencyFlag
+		case "error-rate":
+			profile.ErrorRate = *errorRateFlag
+		case "error-status":
+			profile.ErrorStatus = *errorStatusFlag
+		case "reset-rate":
+			profile.ResetRate = *resetRateFlag
+		case "drip-interval":
+			profile.DripInterval = *dripIntervalFlag
+		case "drip-chunk":
+			profile.DripChunk = *dripChunkFlag
+		case "body-size":
+			profile.BodySize = *bodySizeFlag
+		}
+	})
+	if err := profile.validate(); err != nil {
+		return err
+	}
+	currentProfile.Store(&profile)
+	mainLogger.Printf("Fault profile: %s, seed %d", profile.String(), seed)
+	return nil
+}
+
+// handleProfile shows the current profile (GET) or replaces it (POST). A POST takes the
+// same settings as the command line as form values (profile, latency, error_rate,
+// error_status, reset_rate, drip_interval, drip_chunk, body_size); settings it leaves
+// out come from the named profile, "normal" by default.
+func handleProfile(w http.ResponseWriter, r *http.Request) {
+	if r.Method == http.MethodPost {
+		profile, err := profileFromForm(r)
+		if err != nil {
+			http.Error(w, err.Error(), http.StatusBadRequest)
+			return
+		}
+		currentProfile.Store(profile)
+		mainLogger.Printf("Fault profile changed: %s", profile.String())
+	} else if r.Method != http.MethodGet {
+		http.Error(w, "Method not allowed", http.StatusMethodNotAllowed)
+		return
+	}
+
+	w.Header().Set("Content-Type", "application/json")
+	json.NewEncoder(w).Encode(currentProfile.Load())
+}
+
+// profileFromForm builds a profile from the form values of a /profile request
+func profileFromForm(r *http.Request) (*Profile, error) {
+	if err := r.ParseForm(); err != nil {
+		return nil, err
+	}
+	name := r.FormValue("profile")
+	if name == "" {
+		name = "normal"
+	}
+	preset, ok := profilePresets[name]
+	if !ok {
+		return nil, fmt.Errorf("unknown profile %q", name)
+	}
+	profile := preset
+	profile.Name = name
+
+	var err error
+	parseFloat := func(key string, target *float64) {
+		if value := r.FormValue(key); value != "" && err == nil {
+			*target, err = strconv.ParseFloat(value, 64)
+		}
+	}
+	parseInt := func(key string, target *int) {
+		if value := r.FormValue(key); value != "" && err == nil {
+			*target, err = strconv.Atoi(value)
+		}
+	}
+	if value := r.FormValue("latency"); value != "" {
+		profile.Latency = value
+	}
+	parseFloat("error_rate", &profile.ErrorRate)
+	parseInt("error_status", &profile.ErrorStatus)
+	parseFloat("reset_rate", &profile.ResetRate)
+	if value := r.FormValue("drip_interval"); value != "" && err == nil {
+		profile.DripInterval, err = time.ParseDuration(value)
+	}
+	parseInt("drip_chunk", &profile.DripChunk)
+	parseInt("body_size", &profile.BodySize)
+	if err != nil {
+		return nil, err
+	}
+	if err := profile.validate(); err != nil {
+		return nil, err
+	}
+	return &profile, nil
+}
+
+// profileDecision is what the profile does to one request
+type profileDecision struct {
+	delay time.Duration
+	reset bool
+	fail  bool
+}
+
+func decide(p *Profile) profileDecision {
+	randomMutex.Lock()
+	defer randomMutex.Unlock()
+	decision := profileDecision{delay: p.latency.sample(random)}
+	roll := random.Float64() * 100
+	decision.reset = roll < p.ResetRate
+	decision.fail = !decision.reset && roll < p.ResetRate+p.ErrorRate
+	return decision
+}
+
+// sleepOrDone waits for d, or returns false early if the client goes away
+func sleepOrDone(r *http.Request, d time.Duration) bool {
+	if d <= 0 {
+		return true
+	}
+	timer := time.NewTimer(d)
+	defer timer.Stop()
+	select {
+	case <-timer.C:
+		return true
+	case <-r.Context().Done():
+		return false
+	}
+}
+
+// resetConnection drops the client's connection without a response (a TCP RST where possible)
+func resetConnection(w http.ResponseWriter) {
+	if hijacker, ok := w.(http.Hijacker); ok {
+		if conn, _, err := hijacker.Hijack(); err == nil {
+			if tcp, ok := conn.(*net.TCPConn); ok {
+				tcp.SetLinger(0)
+			}
+			conn.Close()
+			return
+		}
+	}
+	// HTTP/2 cannot hand over the connection; abort the stream instead
+	panic(http.ErrAbortHandler)
+}
+
+// profileWriter holds back an endpoint's response so it can be padded or dripped
+type profileWriter struct {
+	http.ResponseWriter
+	request *http.Request
+	profile *Profile
+	status  int
+	body    bytes.Buffer
+}
+
+func (pw *profileWriter) WriteHeader(status int) {
+	if pw.status == 0 {
+		pw.status = status
+	}
+}
+
+func (pw *profileWriter) Write(data []byte) (int, error) {
+	return pw.body.Write(data)
+}
+
+// finish sends the held-back response, padded to BodySize and in DripChunk pieces
+func (pw *profileWriter) finish() {
+	status := pw.status
+	if status == 0 {
+		status = http.StatusOK
+	}
+	body := pw.body.Bytes()
+	if padding := pw.profile.BodySize - len(body); padding > 0 {
+		body = append(body, bytes.Repeat([]byte("."), padding-1)...)
+		body = append(body, '\n')
+	}
+
+	if pw.profile.DripInterval <= 0 {
+		pw.ResponseWriter.Header().Set("Content-Length", strconv.Itoa(len(body)))
+		pw.ResponseWriter.WriteHeader(status)
+		pw.ResponseWriter.Write(body)
+		return
+	}
+
+	// No Content-Length, so each chunk goes out as soon as it is flushed
+	pw.ResponseWriter.WriteHeader(status)
+	flusher, _ := pw.ResponseWriter.(http.Flusher)
+	for offset := 0; offset < len(body); offset += pw.profile.DripChunk {
+		end := min(offset+pw.profile.DripChunk, len(body))
+		if _, err := pw.ResponseWriter.Write(body[offset:end]); err != nil {
+			return
+		}
+		if flusher != nil {
+			flusher.Flush()
+		}
+		if end < len(body) && !sleepOrDone(pw.request, pw.profile.DripInterval) {
+			return
+		}
+	}
+}
+
+// applyProfile degrades one API request as the current profile says. It returns the
+// writer the endpoint should respond through and a function that sends the response,
+// or handled = true when the profile has already answered (or dropped) the request.
+func applyProfile(w http.ResponseWriter, r *http.Request) (writer http.ResponseWriter, finish func(), handled bool) {
+	profile := currentProfile.Load()
+	if profile == nil {
+		return w, func() {}, false
+	}
+	decision := decide(profile)
+
+	if !sleepOrDone(r, decision.delay) {
+		mainLogger.Printf("Profile: client gave up during the %v delay", decision.delay)
+		return w, nil, true
+	}
+	if decision.delay > 0 {
+		mainLogger.Printf("Profile: delayed %v", decision.delay)
+	}
+
+	if decision.reset {
+		mainLogger.Printf("Profile: connection reset")
+		resetConnection(w)
+		return w, nil, true
+	}
+	if decision.fail {
+		errMsg := fmt.Sprintf("Error: Injected fault (profile %s)", profile.Name)
+		http.Error(w, errMsg, profile.ErrorStatus)
+		mainLogger.Printf("Response: %d - %s", profile.ErrorStatus, errMsg)
+		return w, nil, true
+	}
+
+	if profile.BodySize == 0 && profile.DripInterval <= 0 {
+		return w, func() {}, false
+	}
+	pw := &profileWriter{ResponseWriter: w, request: r, profile: profile}
+	return pw, pw.finish, false
+}
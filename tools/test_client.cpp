@@ -8,6 +8,8 @@
 #include <chrono>
 #include <thread>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <curl/curl.h>
 
 // Platform-specific includes for DLL loading and networking
@@ -33,8 +35,14 @@
 #include <netdb.h>
 #endif
 
-// Type definition for the DLL function
+#include "capture_replay.h"
+
+// Type definitions for the DLL functions
 typedef long (*CustomFunctionType)(const char*, char*);
+typedef long (*ShutdownFunctionType)(long);
+
+// Output buffer size with room for the widest output (99 pairs, e.g. with extract=map)
+const size_t OUTPUT_BUFFER_SIZE = 2 + 99 * (32 + 128);
 
 // Helper function to print a buffer in a readable format
 void printBuffer(const char* buffer, size_t size, const std::string& label) {
@@ -175,6 +183,11 @@ std::string makeHttpRequest(const std::string& host, int port, const std::string
 
     // Set SSL options if using HTTPS
     if (useSSL) {
+        // Collect the server certificate chain for the SSL report
+        if (sslInfo != nullptr) {
+            curl_easy_setopt(curl, CURLOPT_CERTINFO, 1L);
+        }
+
         // Configure SSL verification
         if (!verifySSL) {
             // Disable SSL certificate verification
@@ -203,31 +216,30 @@ std::string makeHttpRequest(const std::string& host, int port, const std::string
     // Capture SSL information if requested
     if (sslInfo != nullptr) {
         // Check if SSL was used
-        long usedSSL = 0;
-        curl_easy_getinfo(curl, CURLINFO_USED_SSL, &usedSSL);
-        sslInfo->isSSL = (usedSSL != 0);
-
-        // Get SSL verification settings
-        long verifyPeer = 0;
-        curl_easy_getopt(curl, CURLOPT_SSL_VERIFYPEER, &verifyPeer);
-        sslInfo->verifyPeer = (verifyPeer != 0);
-
-        long verifyHost = 0;
-        curl_easy_getopt(curl, CURLOPT_SSL_VERIFYHOST, &verifyHost);
-        sslInfo->verifyHost = (verifyHost > 0);
-
-        // Get SSL version
-        char* sslVersion = nullptr;
-        curl_easy_getinfo(curl, CURLINFO_SSL_VERIFYRESULT, &sslVersion);
-        if (sslVersion) {
-            sslInfo->sslVersion = sslVersion;
+        char* scheme = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_SCHEME, &scheme);
+        sslInfo->isSSL = scheme && (strcmp(scheme, "HTTPS") == 0 || strcmp(scheme, "https") == 0);
+
+        // SSL verification settings applied above
+        sslInfo->verifyPeer = useSSL && verifySSL;
+        sslInfo->verifyHost = useSSL && verifySSL;
+
+        // Get SSL library version
+        const curl_version_info_data* versionInfo = curl_version_info(CURLVERSION_NOW);
+        if (sslInfo->isSSL && versionInfo && versionInfo->ssl_version) {
+            sslInfo->sslVersion = versionInfo->ssl_version;
         }
 
-        // Get certificate info
-        char* certInfo = nullptr;
+        // Get certificate info (subject of the server certificate)
+        struct curl_certinfo* certInfo = nullptr;
         curl_easy_getinfo(curl, CURLINFO_CERTINFO, &certInfo);
-        if (certInfo) {
-            sslInfo->certInfo = certInfo;
+        if (certInfo && certInfo->num_of_certs > 0) {
+            for (struct curl_slist* field = certInfo->certinfo[0]; field; field = field->next) {
+                if (strncmp(field->data, "Subject:", 8) == 0) {
+                    sslInfo->certInfo = field->data + 8;
+                    break;
+                }
+            }
         }
     }
 
@@ -253,6 +265,234 @@ std::string extractResponseBody(const std::string& response) {
     return "";
 }
 
+// Load the DLL and resolve functionName; an empty name tries CustomFunctionExample (CustomDLL)
+// and then ProcessContactCenterRequest (CustomDLLStatic). Returns nullptr on failure.
+CustomFunctionType loadDllFunction(const std::string& dllPath, std::string& functionName, void*& dllHandle) {
+    std::vector<std::string> candidates;
+    if (functionName.empty()) {
+        candidates = {"CustomFunctionExample", "ProcessContactCenterRequest"};
+    } else {
+        candidates = {functionName};
+    }
+
+#ifdef _WIN32
+    HMODULE module = LoadLibrary(dllPath.c_str());
+    if (!module) {
+        std::cerr << "Failed to load DLL: " << dllPath << std::endl;
+        std::cerr << "Error code: " << GetLastError() << std::endl;
+        return nullptr;
+    }
+    for (const std::string& candidate : candidates) {
+        CustomFunctionType function = (CustomFunctionType)GetProcAddress(module, candidate.c_str());
+        if (function) {
+            functionName = candidate;
+            dllHandle = module;
+            return function;
+        }
+    }
+    FreeLibrary(module);
+#else
+    void* module = dlopen(dllPath.c_str(), RTLD_LAZY);
+    if (!module) {
+        std::cerr << "Failed to load DLL: " << dllPath << std::endl;
+        std::cerr << "Error: " << dlerror() << std::endl;
+        return nullptr;
+    }
+    for (const std::string& candidate : candidates) {
+        CustomFunctionType function = (CustomFunctionType)dlsym(module, candidate.c_str());
+        if (function) {
+            functionName = candidate;
+            dllHandle = module;
+            return function;
+        }
+    }
+    dlclose(module);
+#endif
+    std::cerr << "Failed to get function pointer from DLL" << std::endl;
+    return nullptr;
+}
+
+// Unload a DLL loaded by loadDllFunction
+void unloadDll(void* dllHandle) {
+#ifdef _WIN32
+    // CustomDLL stays loaded until it has been shut down
+    HMODULE module = static_cast<HMODULE>(dllHandle);
+    if (ShutdownFunctionType shutdown = (ShutdownFunctionType)GetProcAddress(module, "CustomDllShutdown")) {
+        shutdown(-1);
+    }
+    FreeLibrary(module);
+#else
+    dlclose(dllHandle);
+#endif
+}
+
+// Latency histogram for the benchmark, in microseconds.
+// Log-linear buckets (8 per power of two, the same layout as GetDllStats), so every
+// reported percentile is within about 12% of the true value at any scale. Each thread
+// records into its own histogram; they are merged after the run.
+class BenchHistogram {
+public:
+    static constexpr unsigned int BUCKETS = 200;
+
+    void record(unsigned long long micros) {
+        buckets[bucketFor(micros)]++;
+        count++;
+        sum += micros;
+        max = std::max(max, micros);
+    }
+
+    void merge(const BenchHistogram& other) {
+        for (unsigned int i = 0; i < BUCKETS; i++) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    unsigned long long percentile(double percent) const {
+        if (count == 0) {
+            return 0;
+        }
+        const unsigned long long rank = static_cast<unsigned long long>(std::ceil(percent / 100.0 * count));
+        unsigned long long seen = 0;
+        for (unsigned int i = 0; i < BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank && buckets[i] > 0) {
+                return std::min(max, i + 1 < BUCKETS ? lowerBound(i + 1) - 1 : max);
+            }
+        }
+        return max;
+    }
+
+    unsigned long long total() const { return count; }
+    unsigned long long maximum() const { return max; }
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+
+private:
+    static unsigned int bucketFor(unsigned long long value) {
+        if (value < 8) {
+            return static_cast<unsigned int>(value);
+        }
+        unsigned int msb = 3;
+        while (msb < 63 && (value >> (msb + 1)) != 0) {
+            msb++;
+        }
+        const unsigned long long index = (msb - 2) * 8ULL + ((value >> (msb - 3)) - 8);
+        return index < BUCKETS ? static_cast<unsigned int>(index) : BUCKETS - 1;
+    }
+
+    static unsigned long long lowerBound(unsigned int index) {
+        return index < 8 ? index : (8ULL + index % 8) << (index / 8 - 1);
+    }
+
+    unsigned long long buckets[BUCKETS] = {};
+    unsigned long long count = 0;
+    unsigned long long sum = 0;
+    unsigned long long max = 0;
+};
+
+// Benchmark settings from the command line
+struct BenchOptions {
+    int threads = 4;
+    int durationSeconds = 10;
+    double rate = 0;            // Total calls per second; 0 runs closed-loop (each thread calls back to back)
+    std::string functionName;   // Empty picks the export automatically
+};
+
+// Drive the DLL function from several threads and report throughput and latency.
+//
+// With a target rate each thread follows a fixed schedule, and latency is measured from
+// the time a call was scheduled to start rather than when it actually started. A stall
+// therefore shows up in the percentiles for every call it delayed, instead of hiding
+// behind the few calls that were in flight (coordinated omission).
+int runBenchmark(CustomFunctionType function, const std::string& functionName,
+                 const std::map<std::string, std::string>& parameters, const BenchOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    const std::vector<char> inputBuffer = createInputBuffer(parameters);
+    const int threads = std::max(1, options.threads);
+    const bool paced = options.rate > 0;
+    const auto interval = paced
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(threads / options.rate))
+        : Clock::duration::zero();
+
+    std::cout << "=== Benchmark: " << functionName << " ===" << std::endl;
+    std::cout << "Threads: " << threads << ", duration: " << options.durationSeconds << "s, ";
+    if (paced) {
+        std::cout << "target rate: " << options.rate << " calls/s" << std::endl;
+    } else {
+        std::cout << "closed loop" << std::endl;
+    }
+
+    std::vector<BenchHistogram> histograms(threads);
+    std::vector<unsigned long long> failures(threads, 0);
+    std::vector<std::thread> workers;
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+    const Clock::time_point end = start + std::chrono::seconds(options.durationSeconds);
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::vector<char> outputBuffer(OUTPUT_BUFFER_SIZE, 0);
+            // Stagger the paced threads so their calls are spread over the interval
+            Clock::time_point scheduled = start + interval * t / threads;
+            std::this_thread::sleep_until(start);
+
+            while (true) {
+                if (paced) {
+                    if (scheduled >= end) {
+                        break;
+                    }
+                    std::this_thread::sleep_until(scheduled);
+                }
+                const Clock::time_point callStart = paced ? scheduled : Clock::now();
+                if (!paced && callStart >= end) {
+                    break;
+                }
+
+                const long result = function(inputBuffer.data(), outputBuffer.data());
+                const Clock::time_point callEnd = Clock::now();
+
+                histograms[t].record(static_cast<unsigned long long>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(callEnd - callStart).count()));
+                if (result != 0) {
+                    failures[t]++;
+                }
+                scheduled += interval;
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    const double elapsed = std::chrono::duration<double>(std::max(Clock::now(), end) - start).count();
+
+    BenchHistogram combined;
+    unsigned long long failed = 0;
+    for (int t = 0; t < threads; t++) {
+        combined.merge(histograms[t]);
+        failed += failures[t];
+    }
+
+    auto millis = [](unsigned long long micros) { return micros / 1000.0; };
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Calls: " << combined.total() << " (" << failed << " failed)" << std::endl;
+    std::cout << "Throughput: " << std::setprecision(1) << combined.total() / elapsed << " calls/s" << std::endl;
+    std::cout << std::setprecision(3);
+    std::cout << "Latency (ms): mean " << millis(static_cast<unsigned long long>(combined.mean()))
+              << ", p50 " << millis(combined.percentile(50))
+              << ", p90 " << millis(combined.percentile(90))
+              << ", p99 " << millis(combined.percentile(99))
+              << ", p99.9 " << millis(combined.percentile(99.9))
+              << ", max " << millis(combined.maximum()) << std::endl;
+    if (paced) {
+        std::cout << "Latency is measured from each call's scheduled start (corrected for coordinated omission)"
+                  << std::endl;
+    }
+    return failed == 0 ? 0 : 2;
+}
+
 // Test case structure
 struct TestCase {
     std::string name;
@@ -275,6 +515,10 @@ int main(int argc, char* argv[]) {
     bool useHttps = false;
     bool verifySSL = true;
     std::string certFile = "";
+    bool bench = false;
+    BenchOptions benchOptions;
+    std::string replayFile;
+    ReplayOptions replayOptions;
 
     // Initialize curl globally
     curl_global_init(CURL_GLOBAL_DEFAULT);
@@ -301,9 +545,65 @@ int main(int argc, char* argv[]) {
         } else if (arg == "--cert-file" && i + 1 < argc) {
             certFile = argv[++i];
             verifySSL = true;  // If cert file is specified, enable verification
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            benchOptions.threads = std::stoi(argv[++i]);
+            replayOptions.threads = benchOptions.threads;
+        } else if (arg == "--duration" && i + 1 < argc) {
+            benchOptions.durationSeconds = std::stoi(argv[++i]);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            benchOptions.rate = std::stod(argv[++i]);
+        } else if (arg == "--function" && i + 1 < argc) {
+            benchOptions.functionName = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (arg == "--speed" && i + 1 < argc) {
+            replayOptions.speed = std::stod(argv[++i]);
+        } else if (arg == "--max-gap" && i + 1 < argc) {
+            replayOptions.maxGapMs = std::stoll(argv[++i]);
         }
     }
 
+    // Replay a capture file against the DLL
+    if (!replayFile.empty()) {
+        CaptureFile capture;
+        std::string error;
+        if (!capture.open(replayFile, replayOptions.maxGapMs, error)) {
+            std::cerr << error << std::endl;
+            curl_global_cleanup();
+            return 1;
+        }
+        void* dllHandle = nullptr;
+        std::string functionName = benchOptions.functionName;
+        CustomFunctionType replayFunction = loadDllFunction(dllPath, functionName, dllHandle);
+        if (!replayFunction) {
+            curl_global_cleanup();
+            return 1;
+        }
+
+        const std::vector<CapturedCall>& calls = capture.calls();
+        std::cout << "=== Replay: " << replayFile << " through " << functionName << " ===" << std::endl;
+        std::cout << "Captured calls: " << calls.size() << " over "
+                  << (calls.empty() ? 0.0 : calls.back().offsetMicros / 1e6) << "s";
+        if (capture.isTruncated()) {
+            std::cout << " (last record incomplete, skipped)";
+        }
+        std::cout << std::endl;
+        std::cout << "Threads: " << replayOptions.threads << ", ";
+        if (replayOptions.speed > 0) {
+            std::cout << "speed: " << replayOptions.speed << "x" << std::endl;
+        } else {
+            std::cout << "back to back" << std::endl;
+        }
+
+        const ReplayReport report = replayCapture(replayFunction, capture, replayOptions);
+        printReplayReport(report, replayOptions.speed > 0);
+        unloadDll(dllHandle);
+        curl_global_cleanup();
+        return report.failed == 0 ? 0 : 2;
+    }
+
     // Define test cases
     std::vector<TestCase> testCases = {
         {
@@ -354,42 +654,32 @@ int main(int argc, char* argv[]) {
         }
     };
 
-    // Test DLL
-    if (testDll) {
-        std::cout << "=== Testing DLL: " << dllPath << " ===" << std::endl;
-
-        // Load DLL
-#ifdef _WIN32
-        HMODULE dllHandle = LoadLibrary(dllPath.c_str());
-        if (!dllHandle) {
-            std::cerr << "Failed to load DLL: " << dllPath << std::endl;
-            std::cerr << "Error code: " << GetLastError() << std::endl;
+    // Benchmark the DLL with the basic request
+    if (bench) {
+        void* dllHandle = nullptr;
+        std::string functionName = benchOptions.functionName;
+        CustomFunctionType benchFunction = loadDllFunction(dllPath, functionName, dllHandle);
+        if (!benchFunction) {
+            curl_global_cleanup();
             return 1;
         }
+        int benchResult = runBenchmark(benchFunction, functionName, testCases[0].parameters, benchOptions);
+        unloadDll(dllHandle);
+        curl_global_cleanup();
+        return benchResult;
+    }
 
-        // Get function pointer
-        CustomFunctionType customFunction = (CustomFunctionType)GetProcAddress(dllHandle, "CustomFunctionExample");
-        if (!customFunction) {
-            std::cerr << "Failed to get function pointer from DLL" << std::endl;
-            FreeLibrary(dllHandle);
-            return 1;
-        }
-#else
-        void* dllHandle = dlopen(dllPath.c_str(), RTLD_LAZY);
-        if (!dllHandle) {
-            std::cerr << "Failed to load DLL: " << dllPath << std::endl;
-            std::cerr << "Error: " << dlerror() << std::endl;
-            return 1;
-        }
+    // Test DLL
+    if (testDll) {
+        std::cout << "=== Testing DLL: " << dllPath << " ===" << std::endl;
 
-        // Get function pointer
-        CustomFunctionType customFunction = (CustomFunctionType)dlsym(dllHandle, "CustomFunctionExample");
+        // Load DLL and get function pointer
+        void* dllHandle = nullptr;
+        std::string functionName = "CustomFunctionExample";
+        CustomFunctionType customFunction = loadDllFunction(dllPath, functionName, dllHandle);
         if (!customFunction) {
-            std::cerr << "Failed to get function pointer from DLL" << std::endl;
-            dlclose(dllHandle);
             return 1;
         }
-#endif
 
         std::cout << "DLL loaded successfully" << std::endl;
 
@@ -402,7 +692,7 @@ int main(int argc, char* argv[]) {
             std::vector<char> inputBuffer = createInputBuffer(testCase.parameters);
 
             // Create output buffer (initialized to zeros)
-            std::vector<char> outputBuffer(2 + 32 + 128, 0);  // Header + Key + Value
+            std::vector<char> outputBuffer(OUTPUT_BUFFER_SIZE, 0);
 
             // Print input buffer
             printBuffer(inputBuffer.data(), inputBuffer.size(), "Input Buffer");
@@ -466,11 +756,7 @@ int main(int argc, char* argv[]) {
         std::cout << "\nDLL Test Summary: " << passedTests << " of " << testCases.size() << " tests passed" << std::endl;
 
         // Unload DLL
-#ifdef _WIN32
-        FreeLibrary(dllHandle);
-#else
-        dlclose(dllHandle);
-#endif
+        unloadDll(dllHandle);
     }
 
     // Test server
@@ -5,8 +5,11 @@
 #include <cstring>
 #include <windows.h>
 
-// Type definition for the DLL function
+#include "capture_replay.h"
+
+// Type definitions for the DLL functions
 typedef long (*CustomFunctionType)(const char*, char*);
+typedef long (*ShutdownFunctionType)(long);
 
 // Helper function to print a buffer in a readable format
 void printBuffer(const char* buffer, size_t size, const std::string& label) {
@@ -85,6 +88,8 @@ int main(int argc, char* argv[]) {
     // Default settings
     std::string dllPath = "dist\\CustomDLLStatic.dll";
     bool verbose = false;
+    std::string replayFile;
+    ReplayOptions replayOptions;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -93,7 +98,52 @@ int main(int argc, char* argv[]) {
             dllPath = argv[++i];
         } else if (arg == "--verbose" || arg == "-v") {
             verbose = true;
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (arg == "--speed" && i + 1 < argc) {
+            replayOptions.speed = std::stod(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            replayOptions.threads = std::stoi(argv[++i]);
+        } else if (arg == "--max-gap" && i + 1 < argc) {
+            replayOptions.maxGapMs = std::stoll(argv[++i]);
+        }
+    }
+
+    // Replay a capture file, through either DLL's request function
+    if (!replayFile.empty()) {
+        CaptureFile capture;
+        std::string error;
+        if (!capture.open(replayFile, replayOptions.maxGapMs, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        HMODULE dllHandle = LoadLibrary(dllPath.c_str());
+        if (!dllHandle) {
+            std::cerr << "Failed to load DLL: " << dllPath << std::endl;
+            std::cerr << "Error code: " << GetLastError() << std::endl;
+            return 1;
+        }
+        ReplayFunction replayFunction = (ReplayFunction)GetProcAddress(dllHandle, "ProcessContactCenterRequest");
+        if (!replayFunction) {
+            replayFunction = (ReplayFunction)GetProcAddress(dllHandle, "CustomFunctionExample");
         }
+        if (!replayFunction) {
+            std::cerr << "Failed to get function pointer from DLL" << std::endl;
+            FreeLibrary(dllHandle);
+            return 1;
+        }
+
+        std::cout << "=== Replaying " << replayFile << " (" << capture.calls().size() << " calls) through "
+                  << dllPath << " ===" << std::endl;
+        const ReplayReport report = replayCapture(replayFunction, capture, replayOptions);
+        printReplayReport(report, replayOptions.speed > 0);
+
+        // CustomDLL stays loaded until it has been shut down
+        if (ShutdownFunctionType shutdown = (ShutdownFunctionType)GetProcAddress(dllHandle, "CustomDllShutdown")) {
+            shutdown(-1);
+        }
+        FreeLibrary(dllHandle);
+        return report.failed == 0 ? 0 : 2;
     }
 
     std::cout << "=== Testing Static DLL: " << dllPath << " ===" << std::endl;
@@ -0,0 +1,169 @@
+// Reader for the trace ring file written by CustomDLL ([trace] output=file).
+//
+// Prints the spans in the file as one line each, oldest first. With --follow it keeps
+// polling and prints new spans as they are written, which drains the ring while the
+// DLL runs; spans overwritten before they could be read are reported as lost.
+//
+// Usage: TraceDump [--follow] [--interval ms] <trace.bin>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "custom_dll.h"
+
+namespace {
+
+// Read-only view of the whole file
+struct MappedFile {
+    const void* data = nullptr;
+    size_t size = 0;
+
+    bool Open(const char* path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            return false;
+        }
+        data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+#else
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        data = view == MAP_FAILED ? nullptr : view;
+#endif
+        return data != nullptr;
+    }
+};
+
+// The file's 64-bit counters, read atomically (the DLL updates them in place)
+unsigned long long LoadAcquire(const unsigned long long& value) {
+    return reinterpret_cast<const std::atomic<unsigned long long>&>(value).load(std::memory_order_acquire);
+}
+
+enum class SlotState {
+    Ready,   // Span copied out
+    Pending, // Claimed by a writer that has not finished it yet
+    Lost     // Overwritten by a newer span
+};
+
+// Copy span n out of its slot
+SlotState ReadSpan(const TraceSpan* spans, unsigned long long capacity, unsigned long long n, TraceSpan& out) {
+    const TraceSpan& slot = spans[n % capacity];
+    const unsigned long long before = LoadAcquire(slot.sequence);
+    if (before < 2 * n + 2) {
+        return SlotState::Pending;
+    }
+    if (before > 2 * n + 2) {
+        return SlotState::Lost;
+    }
+    memcpy(&out, &slot, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return LoadAcquire(slot.sequence) == before ? SlotState::Ready : SlotState::Lost;
+}
+
+void PrintSpan(const TraceSpan& span) {
+    char traceId[33];
+    for (size_t i = 0; i < sizeof(span.traceId); i++) {
+        snprintf(traceId + 2 * i, 3, "%02x", span.traceId[i]);
+    }
+    printf("%llu trace=%s span=%016llx result=%llu curl=%llu http=%llu flags=%llx call=%llu parse=%llu "
+           "build=%llu dns=%llu connect=%llu tls=%llu wait=%llu download=%llu total=%llu\n",
+           span.startMicros, traceId, span.spanId, span.result, span.curlCode, span.httpCode, span.flags,
+           span.callMicros, span.parseMicros, span.buildMicros, span.dnsMicros, span.connectMicros,
+           span.tlsMicros, span.waitMicros, span.downloadMicros, span.totalMicros);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool follow = false;
+    long intervalMs = 200;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--follow") {
+            follow = true;
+        } else if (arg == "--interval" && i + 1 < argc) {
+            intervalMs = std::stol(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: TraceDump [--follow] [--interval ms] <trace.bin>\n");
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        fprintf(stderr, "Cannot map %s\n", path);
+        return 1;
+    }
+    const TraceFileHeader* header = static_cast<const TraceFileHeader*>(file.data);
+    if (file.size < sizeof(TraceFileHeader) || header->magic != TRACE_FILE_MAGIC ||
+        header->version != TRACE_FILE_VERSION || header->spanSize != sizeof(TraceSpan) ||
+        file.size < sizeof(TraceFileHeader) + header->capacity * sizeof(TraceSpan)) {
+        fprintf(stderr, "%s is not a version %d trace file\n", path, TRACE_FILE_VERSION);
+        return 1;
+    }
+    const unsigned long long capacity = header->capacity;
+    const TraceSpan* spans = reinterpret_cast<const TraceSpan*>(header + 1);
+
+    // Start with the oldest span still in the ring
+    unsigned long long next = LoadAcquire(header->next);
+    unsigned long long n = next > capacity ? next - capacity : 0;
+    for (;;) {
+        next = LoadAcquire(header->next);
+        if (next - n > capacity) {
+            fprintf(stderr, "lost %llu spans\n", next - n - capacity);
+            n = next - capacity;
+        }
+        for (; n < next; n++) {
+            TraceSpan span;
+            const SlotState state = ReadSpan(spans, capacity, n, span);
+            if (state == SlotState::Pending) {
+                break; // Try again on the next poll
+            }
+            if (state == SlotState::Ready) {
+                PrintSpan(span);
+            }
+        }
+        fflush(stdout);
+        if (!follow) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+}